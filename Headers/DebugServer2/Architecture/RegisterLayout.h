@@ -13,6 +13,7 @@
 #include "DebugServer2/Base.h"
 #include "DebugServer2/Types.h"
 
+#include <algorithm>
 #include <map>
 
 namespace ds2 {
@@ -169,7 +170,48 @@ struct GPRegisterValue {
   uint64_t value;
 };
 
-typedef std::map<size_t, GPRegisterValue> GPRegisterStopMap;
+//
+// A stop reply carries a few dozen registers at most, keeping them in one
+// vector costs a single allocation instead of one per map node.
+//
+class GPRegisterStopMap {
+public:
+  typedef std::pair<size_t, GPRegisterValue> value_type;
+  typedef std::vector<value_type>::const_iterator const_iterator;
+
+private:
+  static size_t const kInitialCapacity = 32;
+
+private:
+  std::vector<value_type> _regs;
+
+public:
+  GPRegisterValue &operator[](size_t index) {
+    for (auto &reg : _regs) {
+      if (reg.first == index)
+        return reg.second;
+    }
+    if (_regs.empty()) {
+      _regs.reserve(kInitialCapacity);
+    }
+    _regs.push_back(value_type(index, GPRegisterValue()));
+    return _regs.back().second;
+  }
+
+  const_iterator find(size_t index) const {
+    return std::find_if(
+        _regs.begin(), _regs.end(),
+        [index](value_type const &reg) { return reg.first == index; });
+  }
+
+public:
+  inline const_iterator begin() const { return _regs.begin(); }
+  inline const_iterator end() const { return _regs.end(); }
+  inline bool empty() const { return _regs.empty(); }
+  inline size_t size() const { return _regs.size(); }
+  inline void clear() { _regs.clear(); }
+};
+
 typedef std::vector<GPRegisterValue> GPRegisterValueVector;
 
 //
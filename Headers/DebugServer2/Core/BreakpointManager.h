@@ -103,6 +103,9 @@ protected:
                                    Target::Thread *thread = nullptr) = 0;
   virtual ErrorCode disableLocation(Site const &site,
                                     Target::Thread *thread = nullptr) = 0;
+  // Enable or disable all sites; by default, one location after the other.
+  virtual void enableLocations(Target::Thread *thread);
+  virtual void disableLocations(Target::Thread *thread);
   virtual bool enabled(Target::Thread *thread = nullptr) const = 0;
 
 public:
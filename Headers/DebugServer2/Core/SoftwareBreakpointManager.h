@@ -36,6 +36,13 @@ protected:
                                    Target::Thread *thread = nullptr) override;
   virtual ErrorCode disableLocation(Site const &site,
                                     Target::Thread *thread = nullptr) override;
+  void enableLocations(Target::Thread *thread) override;
+  void disableLocations(Target::Thread *thread) override;
+
+private:
+  // Sites sorted by address and grouped by page, so that each group can be
+  // patched with a single read and a single write.
+  void groupSitesByPage(std::vector<std::vector<Site>> &groups) const;
 
 public:
   void enable(Target::Thread *thread = nullptr) override;
@@ -62,6 +69,13 @@ public:
 
   virtual bool enabled(Target::Thread *thread = nullptr) const override;
 
+public:
+  // Enumerates the original instructions of the breakpoints that are currently
+  // inserted, so they can be restored in a child that was forked with them.
+  void enumerateSavedInstructions(
+      std::function<void(Address const &, ByteVector const &)> const &cb)
+      const;
+
 public:
   virtual bool fillStopInfo(Target::Thread *thread,
                             StopInfo &stopInfo) override;
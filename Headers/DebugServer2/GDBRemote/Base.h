@@ -15,6 +15,10 @@
 namespace ds2 {
 namespace GDBRemote {
 
+// Largest packet we accept, as advertised in qSupported; replies that can be
+// split are kept within it too.
+static size_t const kMaxPacketSize = 0x3fff;
+
 enum CompatibilityMode {
   kCompatibilityModeGDB,
   kCompatibilityModeGDBMultiprocess,
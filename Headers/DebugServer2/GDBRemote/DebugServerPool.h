@@ -0,0 +1,60 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include "DebugServer2/Types.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace ds2 {
+namespace GDBRemote {
+
+// Keeps a number of `ds2 slave` processes launched and listening, so that
+// platform sessions can hand one out on qLaunchGDBServer instead of paying for
+// an exec, a listen and a handshake every time. The pool is refilled in the
+// background as servers get handed out.
+class DebugServerPool {
+public:
+  struct Server {
+    uint16_t port;
+    ProcessId pid;
+  };
+
+private:
+  std::deque<Server> _servers;
+  std::condition_variable _cond;
+  std::mutex _lock;
+  std::thread _thread;
+  size_t _size;
+  bool _terminated;
+
+public:
+  DebugServerPool(size_t size);
+  ~DebugServerPool();
+
+public:
+  void start();
+  void stop();
+
+public:
+  ErrorCode acquire(uint16_t &port, ProcessId &pid);
+
+public:
+  static ErrorCode Launch(uint16_t &port, ProcessId &pid);
+
+private:
+  void run();
+};
+} // namespace GDBRemote
+} // namespace ds2
@@ -12,32 +12,83 @@
 
 #include "DebugServer2/GDBRemote/DummySessionDelegateImpl.h"
 #include "DebugServer2/GDBRemote/Mixins/FileOperationsMixin.h"
+#if defined(OS_LINUX)
+#include "DebugServer2/Host/Linux/ExecWatcher.h"
+#include "DebugServer2/Host/Linux/ProfileSampler.h"
+#include "DebugServer2/Host/Linux/StackSampler.h"
+#endif
 #include "DebugServer2/Host/ProcessSpawner.h"
 #include "DebugServer2/Target/Process.h"
 #include "DebugServer2/Target/Thread.h"
 #include "DebugServer2/Utils/MPL.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 
 namespace ds2 {
 namespace GDBRemote {
 class DebugSessionImplBase : public DummySessionDelegateImpl {
 protected:
   Target::Process *_process;
+  // The other processes we are tracing, e.g.: children we followed after a
+  // fork. Only `_process` gets resumed.
+  std::map<ProcessId, Target::Process *> _inferiors;
+  // Stopped copies of `_process` taken with `monitor checkpoint`, by number.
+  std::map<int, Target::Process *> _checkpoints;
+  int _nextCheckpoint;
+  // The ids the debugger knew the thread of a restored checkpoint by; they
+  // keep designating it, as only the next stop reply has the new ones.
+  ProcessThreadId _restoredPtid;
+  mutable uint32_t _reportedEvents;
+  bool _detachOnFork;
+  bool _persistent;
   std::vector<int> _programmedSignals;
   std::map<uint64_t, size_t> _allocations;
   std::map<uint64_t, Architecture::CPUState> _savedRegisters;
+  std::vector<uint32_t> _expeditedRegisters;
   Host::ProcessSpawner _spawner;
 
 protected:
-  // a struct to help iterate over the thread list for onQueryThreadList
-  mutable IterationState<ThreadId> _threadIterationState;
+  // PCs of the threads of the stopped process, for thread-pcs; forgotten
+  // when it resumes, is replaced or registers are written.
+  mutable std::map<ThreadId, uint64_t> _threadPCs;
+  // The jstopinfo JSON of the current stop, built on first use and forgotten
+  // likewise.
+  std::string _threadsStopInfo;
 
 protected:
   std::mutex _resumeSessionLock;
   Session *_resumeSession;
+  // Same as `_resumeSession`, readable without the lock: other threads take
+  // it briefly while the process runs.
+  std::atomic<Session *> _runningSession;
   std::string _consoleBuffer;
 
+#if defined(OS_LINUX)
+protected:
+  // Asynchronous profiling samples the process from its own thread, and only
+  // sends `A` packets while the process runs. `_profiledPid` is only valid
+  // while `_resumeSession` is set.
+  std::unique_ptr<Host::Linux::ProfileSampler> _profileSampler;
+  std::thread _profilerThread;
+  std::mutex _profilerLock;
+  std::condition_variable _profilerCond;
+  bool _profilerEnabled;
+  uint32_t _profilerInterval;
+  uint32_t _profilerScanType;
+  ProcessId _profiledPid;
+  std::unique_ptr<Host::Linux::StackSampler> _stackSampler;
+  // Folded samples being transferred, from the first qXfer chunk to the last.
+  std::string _foldedStackSamples;
+  // Set while waiting for a process to attach to, so that an interrupt or a
+  // disconnect can give up on it.
+  std::mutex _execWatcherLock;
+  std::unique_ptr<Host::Linux::ExecWatcher> _execWatcher;
+#endif
+
 public:
   DebugSessionImplBase(StringCollection const &args,
                        EnvironmentBlock const &env);
@@ -45,11 +96,24 @@ public:
   DebugSessionImplBase();
   ~DebugSessionImplBase() override;
 
+public:
+  inline void setDetachOnFork(bool detach) { _detachOnFork = detach; }
+  inline void setPersistent(bool persistent) { _persistent = persistent; }
+
+public:
+  // In persistent mode, the process and everything we know about it is kept
+  // when the debugger disconnects, so that another one can take over without
+  // attaching again. Called once the session is over, this forgets what the
+  // previous debugger set up and returns whether there's still a process to
+  // debug.
+  bool prepareReconnect();
+
 protected:
   size_t getGPRSize() const override;
 
 protected:
   ErrorCode onInterrupt(Session &session) override;
+  ErrorCode onDisconnect(Session &session) override;
 
 protected:
   ErrorCode onQuerySupported(Session &session,
@@ -59,14 +123,21 @@ protected:
                           std::vector<int> const &signals) override;
   ErrorCode onProgramSignals(Session &session,
                              std::vector<int> const &signals) override;
+  ErrorCode
+  onSetExpeditedRegisters(Session &session,
+                          std::vector<uint32_t> const &regnos) override;
   ErrorCode onNonStopMode(Session &session, bool enable) override;
   ErrorCode onSendInput(Session &session, ByteVector const &buf) override;
+  ErrorCode onExecuteCommand(Session &session,
+                             std::string const &command) override;
 
 protected:
   ErrorCode onQueryCurrentThread(Session &session,
                                  ProcessThreadId &ptid) const override;
   ErrorCode onThreadIsAlive(Session &session,
-                            ProcessThreadId const &ptid) override;
+                            ProcessThreadId const &ptid) const override;
+  ErrorCode onSelectThread(Session &session,
+                           ProcessThreadId const &ptid) override;
   ErrorCode onQueryAttached(Session &session, ProcessId pid,
                             bool &attachedProcess) const override;
   ErrorCode onQueryProcessInfo(Session &session,
@@ -77,7 +148,8 @@ protected:
                                   StopInfo &stop) const override;
 
   ErrorCode onQueryThreadList(Session &session, ProcessId pid, ThreadId lastTid,
-                              ThreadId &tid) const override;
+                              size_t count,
+                              std::vector<ThreadId> &tids) const override;
 
   ErrorCode onQueryFileLoadAddress(Session &session,
                                    std::string const &file_path,
@@ -91,6 +163,10 @@ protected:
   ErrorCode onQuerySharedLibrariesInfoAddress(Session &session,
                                               Address &address) const override;
 
+protected:
+  ErrorCode onSaveCore(Session &session, std::string const &pathHint,
+                       std::string &path) override;
+
 protected:
   ErrorCode onXferRead(Session &session, std::string const &object,
                        std::string const &annex, uint64_t offset,
@@ -133,6 +209,24 @@ protected:
 
   ErrorCode onQueryMemoryRegionInfo(Session &session, Address const &address,
                                     MemoryRegionInfo &info) const override;
+  ErrorCode onEnableDirtyPageTracking(Session &session, bool enable) override;
+  ErrorCode
+  onQueryDirtyMemoryRanges(Session &session,
+                           MemoryRange::Collection &ranges) const override;
+
+  ErrorCode onSymbolicateAddresses(Session &session,
+                                   std::vector<uint64_t> const &addresses,
+                                   SymbolInfo::Collection &symbols) override;
+
+protected:
+  ErrorCode onEnableAsynchronousProfiling(Session &session,
+                                          ProcessThreadId const &ptid,
+                                          bool enabled, uint32_t interval,
+                                          uint32_t scanType) override;
+  ErrorCode onQueryProfileData(Session &session, ProcessThreadId const &ptid,
+                               uint32_t scanType, ProfileData &data) override;
+  ErrorCode onEnableStackSampling(Session &session,
+                                  uint32_t frequency) override;
 
 protected:
   ErrorCode onSetEnvironmentVariable(Session &session, std::string const &name,
@@ -145,6 +239,8 @@ protected:
 protected:
   ErrorCode onAttach(Session &session, ProcessId pid, AttachMode mode,
                      StopInfo &stop) override;
+  ErrorCode onAttach(Session &session, std::string const &name, AttachMode mode,
+                     StopInfo &stop) override;
 
 protected:
   ErrorCode onResume(Session &session,
@@ -165,23 +261,37 @@ protected:
                                Address const &address, uint32_t kind) override;
 
 protected:
+  Target::Process *findProcess(ProcessThreadId const &ptid) const;
   Target::Thread *findThread(ProcessThreadId const &ptid) const;
+  void setProcess(Target::Process *process);
+  void switchProcess(Target::Process *process);
+  bool cancelAttachWait();
+  void releaseProcess(Target::Process *process);
+  ErrorCode createCheckpoint(Session &session);
+  ErrorCode restoreCheckpoint(Session &session, int id);
+  ErrorCode deleteCheckpoint(int id);
   ErrorCode queryStopInfo(Session &session, Target::Thread *thread,
-                          StopInfo &stop) const;
+                          StopInfo &stop, bool listThreads = true) const;
   ErrorCode queryStopInfo(Session &session, ProcessThreadId const &ptid,
                           StopInfo &stop) const;
+  void queryThreadPCs(Target::Process *process, StopInfo &stop) const;
 
 protected:
   ErrorCode fetchStopInfoForAllThreads(Session &session,
                                        std::vector<StopInfo> &stops,
                                        StopInfo &processStop) override;
   ErrorCode createThreadsStopInfo(Session &session,
-                                  JSArray &threadsStopInfo) override;
+                                  std::string &threadsStopInfo) override;
 
 private:
   ErrorCode spawnProcess(StringCollection const &args,
                          EnvironmentBlock const &env);
   void appendOutput(char const *buf, size_t size);
+#if defined(OS_LINUX)
+  void profilerThread();
+  void stopProfiler();
+  ErrorCode foldStackSamples(std::string &folded);
+#endif
 };
 
 using DebugSessionImpl =
@@ -63,6 +63,9 @@ protected: // Debugging Session
                           std::vector<int> const &signals) override;
   ErrorCode onProgramSignals(Session &session,
                              std::vector<int> const &signals) override;
+  ErrorCode
+  onSetExpeditedRegisters(Session &session,
+                          std::vector<uint32_t> const &regnos) override;
 
   ErrorCode onQuerySymbol(Session &session, std::string const &name,
                           std::string const &value,
@@ -92,12 +95,15 @@ protected: // Debugging Session
                                   bool &isSegment) const override;
   ErrorCode onQuerySharedLibrariesInfoAddress(Session &session,
                                               Address &address) const override;
-  ErrorCode onQuerySharedLibraryInfo(Session &session, std::string const &path,
-                                     std::string const &triple,
-                                     SharedLibraryInfo &info) const override;
+  ErrorCode onQueryModuleInfo(Session &session, std::string const &path,
+                              ModuleInfo &info) const override;
+
+  ErrorCode onSaveCore(Session &session, std::string const &pathHint,
+                       std::string &path) override;
 
   ErrorCode onRestart(Session &session, ProcessId pid) override;
   ErrorCode onInterrupt(Session &session) override;
+  ErrorCode onDisconnect(Session &session) override;
   ErrorCode onTerminate(Session &session, ProcessThreadId const &ptid,
                         StopInfo &stop) override;
   ErrorCode onExitServer(Session &session) override;
@@ -105,12 +111,13 @@ protected: // Debugging Session
   ErrorCode onSynchronizeThreadState(Session &session, ProcessId pid) override;
 
   //
-  // If lastTid is kAllThreadId, it's the first request; if it's kAnyThreadId
-  // the next of the previous request, in any other case the thread next to
-  // the one specified.
+  // Lists up to `count` threads, in increasing order: the first ones if
+  // lastTid is kAllThreadId, or the ones following lastTid otherwise. An
+  // empty list means there are no more threads.
   //
   ErrorCode onQueryThreadList(Session &session, ProcessId pid, ThreadId lastTid,
-                              ThreadId &tid) const override;
+                              size_t count,
+                              std::vector<ThreadId> &tids) const override;
 
   ErrorCode onQueryThreadStopInfo(Session &session, ProcessThreadId const &ptid,
                                   StopInfo &stop) const override;
@@ -118,7 +125,9 @@ protected: // Debugging Session
   ErrorCode onQueryCurrentThread(Session &session,
                                  ProcessThreadId &ptid) const override;
   ErrorCode onThreadIsAlive(Session &session,
-                            ProcessThreadId const &ptid) override;
+                            ProcessThreadId const &ptid) const override;
+  ErrorCode onSelectThread(Session &session,
+                           ProcessThreadId const &ptid) override;
   ErrorCode onQueryThreadInfo(Session &session, ProcessThreadId const &ptid,
                               uint32_t mode, void *info) const override;
 
@@ -133,7 +142,9 @@ protected: // Debugging Session
                                           bool enabled, uint32_t interval,
                                           uint32_t scanType) override;
   ErrorCode onQueryProfileData(Session &session, ProcessThreadId const &ptid,
-                               uint32_t scanType, void *data) const override;
+                               uint32_t scanType, ProfileData &data) override;
+  ErrorCode onEnableStackSampling(Session &session,
+                                  uint32_t frequency) override;
 
   ErrorCode onResume(Session &session,
                      ThreadResumeAction::Collection const &actions,
@@ -168,6 +179,14 @@ protected: // Debugging Session
                                Address const &address) override;
   ErrorCode onQueryMemoryRegionInfo(Session &session, Address const &address,
                                     MemoryRegionInfo &info) const override;
+  ErrorCode onEnableDirtyPageTracking(Session &session, bool enable) override;
+  ErrorCode
+  onQueryDirtyMemoryRanges(Session &session,
+                           MemoryRange::Collection &ranges) const override;
+
+  ErrorCode onSymbolicateAddresses(Session &session,
+                                   std::vector<uint64_t> const &addresses,
+                                   SymbolInfo::Collection &symbols) override;
 
   ErrorCode onComputeCRC(Session &session, Address const &address,
                          size_t length, uint32_t &crc) override;
@@ -197,7 +216,7 @@ protected: // Debugging Session
                                        std::vector<StopInfo> &stops,
                                        StopInfo &processStop) override;
   ErrorCode createThreadsStopInfo(Session &session,
-                                  JSArray &threadsStopInfo) override;
+                                  std::string &threadsStopInfo) override;
 
 protected: // Platform Session
   ErrorCode onDisableASLR(Session &session, bool disable) override;
@@ -51,6 +51,12 @@ protected:
   ErrorCode onFileSetPermissions(Session &session, std::string const &path,
                                  uint32_t mode) override;
 
+protected:
+  ErrorCode onFileComputeMD5(Session &session, std::string const &path,
+                             uint8_t digest[16]) override;
+  ErrorCode onQueryModuleInfo(Session &session, std::string const &path,
+                              ModuleInfo &info) const override;
+
 #if 0
     // more F packets:
     // https://sourceware.org/gdb/onlinedocs/gdb/List-of-Supported-Calls.html#List-of-Supported-Calls
@@ -0,0 +1,86 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include "DebugServer2/GDBRemote/DebugServerPool.h"
+#include "DebugServer2/Host/Socket.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace ds2 {
+namespace GDBRemote {
+
+// Serves platform clients from a single epoll loop and a fixed number of
+// worker threads. A client only occupies a worker while one of its requests
+// is being handled; idle connections just sit in the epoll set.
+class PlatformServer {
+public:
+  struct Stats {
+    size_t activeClients;
+    size_t peakClients;
+    uint64_t acceptedClients;
+    uint64_t rejectedClients;
+    uint64_t expiredClients;
+    uint64_t requests;
+
+    Stats()
+        : activeClients(0), peakClients(0), acceptedClients(0),
+          rejectedClients(0), expiredClients(0), requests(0) {}
+  };
+
+private:
+  struct Client;
+
+private:
+  std::unique_ptr<Host::Socket> _server;
+  DebugServerPool *_debugServerPool;
+  size_t _maxClients;
+  std::chrono::seconds _idleTimeout;
+  int _epollfd;
+  std::vector<std::thread> _workers;
+  std::set<Client *> _clients;
+  std::deque<Client *> _ready;
+  std::condition_variable _cond;
+  std::mutex _lock;
+  Stats _stats;
+  bool _terminated;
+
+public:
+  // A `maxClients` or `idleTimeout` of zero means no limit.
+  PlatformServer(std::unique_ptr<Host::Socket> server,
+                 DebugServerPool *debugServerPool, size_t maxClients,
+                 unsigned idleTimeout);
+  ~PlatformServer();
+
+public:
+  ErrorCode run(size_t numWorkers);
+
+public:
+  Stats stats();
+
+private:
+  void acceptClient();
+  void removeClient(Client *client);
+  void expireIdleClients();
+  bool arm(Client *client, int op);
+
+private:
+  void workerThread();
+};
+} // namespace GDBRemote
+} // namespace ds2
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include "DebugServer2/GDBRemote/DebugServerPool.h"
 #include "DebugServer2/GDBRemote/DummySessionDelegateImpl.h"
 #include "DebugServer2/GDBRemote/Mixins/FileOperationsMixin.h"
 #include "DebugServer2/GDBRemote/Mixins/ProcessLaunchMixin.h"
@@ -21,10 +22,11 @@ namespace GDBRemote {
 class PlatformSessionImplBase : public DummySessionDelegateImpl {
 protected:
   // a struct to help iterate over the process list for onQueryProcessList
-  mutable IterationState<ProcessId> _processIterationState;
+  mutable IterationState<ProcessInfo> _processIterationState;
+  DebugServerPool *_debugServerPool;
 
 public:
-  PlatformSessionImplBase();
+  PlatformSessionImplBase(DebugServerPool *debugServerPool = nullptr);
 
 protected:
   ErrorCode onQueryProcessList(Session &session, ProcessInfoMatch const &match,
@@ -23,10 +23,27 @@ class Session : public SessionBase {
 protected:
   std::map<char, ProcessThreadId> _ptids;
   bool _threadsInStopReply;
+  // Last thread sent by qfThreadInfo/qsThreadInfo, or kAnyThreadId once the
+  // whole list was sent.
+  ThreadId _threadListCursor;
+  // Reused by every stop reply so that its capacity carries over from one
+  // stop to the next; only touched by the thread handling packets.
+  std::string _stopReply;
 
 public:
   Session(CompatibilityMode mode);
 
+public:
+  // Called by the thread reading packets once the connection is lost.
+  void onDisconnect();
+
+public:
+  inline bool threadsInStopReply() const { return _threadsInStopReply; }
+
+private:
+  void sendStopReply(StopInfo const &stop);
+  void sendThreadList(ThreadId lastTid);
+
 private:
   void Handle_ControlC(ProtocolInterpreter::Handler const &,
                        std::string const &);
@@ -51,6 +68,8 @@ private:
   void Handle_I(ProtocolInterpreter::Handler const &, std::string const &);
   void Handle_i(ProtocolInterpreter::Handler const &, std::string const &);
   void Handle_k(ProtocolInterpreter::Handler const &, std::string const &);
+  void Handle_jModulesInfo(ProtocolInterpreter::Handler const &,
+                           std::string const &);
   void Handle_jThreadsInfo(ProtocolInterpreter::Handler const &,
                            std::string const &);
   void Handle__M(ProtocolInterpreter::Handler const &, std::string const &);
@@ -65,6 +84,10 @@ private:
                       std::string const &);
   void Handle_QDisableRandomization(ProtocolInterpreter::Handler const &,
                                     std::string const &);
+  void Handle_QEnableDirtyPageTracking(ProtocolInterpreter::Handler const &,
+                                       std::string const &);
+  void Handle_QEnableStackSampling(ProtocolInterpreter::Handler const &,
+                                   std::string const &);
   void Handle_QEnvironment(ProtocolInterpreter::Handler const &,
                            std::string const &);
   void Handle_QEnvironmentHexEncoded(ProtocolInterpreter::Handler const &,
@@ -83,6 +106,8 @@ private:
                               std::string const &);
   void Handle_QSetEnableAsyncProfiling(ProtocolInterpreter::Handler const &,
                                        std::string const &);
+  void Handle_QSetExpeditedRegisters(ProtocolInterpreter::Handler const &,
+                                     std::string const &);
   void Handle_QSetLogging(ProtocolInterpreter::Handler const &,
                           std::string const &);
   void Handle_QSetSTDERR(ProtocolInterpreter::Handler const &,
@@ -111,6 +136,8 @@ private:
                         std::string const &);
   void Handle_qC(ProtocolInterpreter::Handler const &, std::string const &);
   void Handle_qCRC(ProtocolInterpreter::Handler const &, std::string const &);
+  void Handle_qDirtyMemoryRanges(ProtocolInterpreter::Handler const &,
+                                 std::string const &);
   void Handle_qFileLoadAddress(ProtocolInterpreter::Handler const &,
                                std::string const &);
   void Handle_qGDBServerVersion(ProtocolInterpreter::Handler const &,
@@ -156,6 +183,8 @@ private:
   void Handle_qRcmd(ProtocolInterpreter::Handler const &, std::string const &);
   void Handle_qRegisterInfo(ProtocolInterpreter::Handler const &,
                             std::string const &);
+  void Handle_qSaveCore(ProtocolInterpreter::Handler const &,
+                        std::string const &);
   void Handle_qSearch(ProtocolInterpreter::Handler const &,
                       std::string const &);
   void Handle_qShlibInfoAddr(ProtocolInterpreter::Handler const &,
@@ -171,6 +200,8 @@ private:
                                        std::string const &);
   void Handle_qSymbol(ProtocolInterpreter::Handler const &,
                       std::string const &);
+  void Handle_qSymbolicateAddresses(ProtocolInterpreter::Handler const &,
+                                    std::string const &);
   void Handle_qThreadStopInfo(ProtocolInterpreter::Handler const &,
                               std::string const &);
   void Handle_qThreadExtraInfo(ProtocolInterpreter::Handler const &,
@@ -15,6 +15,7 @@
 #include "DebugServer2/GDBRemote/ProtocolInterpreter.h"
 #include "DebugServer2/GDBRemote/Types.h"
 #include "DebugServer2/Host/Channel.h"
+#include "DebugServer2/Utils/HexValues.h"
 #include "DebugServer2/Utils/Log.h"
 
 #include <algorithm>
@@ -67,11 +68,13 @@ public:
   }
 
   template <typename T> bool send(T const &data, bool escaped = false) {
-    std::ostringstream ss;
     static std::string const searchStr = "$#}*";
+    std::string final_data;
     uint8_t csum;
 
-    ss << '$';
+    // Frame the packet in a single allocation: '$', data, '#' and checksum.
+    final_data.reserve(data.size() + 4);
+    final_data += '$';
 
     //
     // If data contains $, #, } or * we need to escape the
@@ -81,19 +84,17 @@ public:
         std::find_first_of(data.begin(), data.end(), searchStr.begin(),
                            searchStr.end()) != data.end()) {
       std::string encoded = Escape(data);
-      ss << encoded;
+      final_data += encoded;
       csum = Checksum(encoded);
     } else {
-      for (char c : data) {
-        ss << c;
-      }
+      final_data.append(data.begin(), data.end());
       csum = Checksum(data);
     }
 
-    ss << '#' << std::hex << std::setw(2) << std::setfill('0')
-       << (unsigned)csum;
+    final_data += '#';
+    final_data += NibbleToHex(csum >> 4);
+    final_data += NibbleToHex(csum & 0x0f);
 
-    std::string final_data = ss.str();
     DS2LOG(Packet, "putpkt(\"%s\", %u)", final_data.c_str(),
            (unsigned)final_data.length());
 
@@ -66,6 +66,9 @@ protected: // Debugging Session
                                   std::vector<int> const &signals) = 0;
   virtual ErrorCode onProgramSignals(Session &session,
                                      std::vector<int> const &signals) = 0;
+  virtual ErrorCode
+  onSetExpeditedRegisters(Session &session,
+                          std::vector<uint32_t> const &regnos) = 0;
 
   virtual ErrorCode onQuerySymbol(Session &session, std::string const &name,
                                   std::string const &value,
@@ -99,13 +102,20 @@ protected: // Debugging Session
   virtual ErrorCode
   onQuerySharedLibrariesInfoAddress(Session &session,
                                     Address &address) const = 0;
-  virtual ErrorCode onQuerySharedLibraryInfo(Session &session,
-                                             std::string const &path,
-                                             std::string const &triple,
-                                             SharedLibraryInfo &info) const = 0;
+  virtual ErrorCode onQueryModuleInfo(Session &session,
+                                      std::string const &path,
+                                      ModuleInfo &info) const = 0;
+
+  // Writes a core file of the current process on the target and returns
+  // where it was written. `pathHint` may be empty.
+  virtual ErrorCode onSaveCore(Session &session, std::string const &pathHint,
+                               std::string &path) = 0;
 
   virtual ErrorCode onRestart(Session &session, ProcessId pid) = 0;
   virtual ErrorCode onInterrupt(Session &session) = 0;
+  // Called from the session thread when the connection to the debugger is
+  // lost, which can happen while the process is running.
+  virtual ErrorCode onDisconnect(Session &session) = 0;
   virtual ErrorCode onTerminate(Session &session, ProcessThreadId const &ptid,
                                 StopInfo &stop) = 0;
   virtual ErrorCode onExitServer(Session &session) = 0;
@@ -114,18 +124,20 @@ protected: // Debugging Session
                                              ProcessId pid) = 0;
 
   //
-  // If lastTid is kAllThreadId, it's the first request; if it's kAnyThreadId
-  // the next of the previous request, in any other case the thread next to
-  // the one specified.
+  // Lists up to `count` threads, in increasing order: the first ones if
+  // lastTid is kAllThreadId, or the ones following lastTid otherwise. An
+  // empty list means there are no more threads.
   //
   virtual ErrorCode onQueryThreadList(Session &session, ProcessId pid,
-                                      ThreadId lastTid,
-                                      ThreadId &tid) const = 0;
+                                      ThreadId lastTid, size_t count,
+                                      std::vector<ThreadId> &tids) const = 0;
 
   virtual ErrorCode onQueryCurrentThread(Session &session,
                                          ProcessThreadId &ptid) const = 0;
   virtual ErrorCode onThreadIsAlive(Session &session,
-                                    ProcessThreadId const &ptid) = 0;
+                                    ProcessThreadId const &ptid) const = 0;
+  virtual ErrorCode onSelectThread(Session &session,
+                                   ProcessThreadId const &ptid) = 0;
   virtual ErrorCode onQueryThreadInfo(Session &session,
                                       ProcessThreadId const &ptid,
                                       uint32_t mode, void *info) const = 0;
@@ -146,7 +158,10 @@ protected: // Debugging Session
                                                   uint32_t scanType) = 0;
   virtual ErrorCode onQueryProfileData(Session &session,
                                        ProcessThreadId const &ptid,
-                                       uint32_t scanType, void *data) const = 0;
+                                       uint32_t scanType,
+                                       ProfileData &data) = 0;
+  virtual ErrorCode onEnableStackSampling(Session &session,
+                                          uint32_t frequency) = 0;
 
   virtual ErrorCode onResume(Session &session,
                              ThreadResumeAction::Collection const &actions,
@@ -187,6 +202,16 @@ protected: // Debugging Session
   virtual ErrorCode onQueryMemoryRegionInfo(Session &session,
                                             Address const &address,
                                             MemoryRegionInfo &info) const = 0;
+  virtual ErrorCode onEnableDirtyPageTracking(Session &session,
+                                              bool enable) = 0;
+  virtual ErrorCode
+  onQueryDirtyMemoryRanges(Session &session,
+                           MemoryRange::Collection &ranges) const = 0;
+
+  virtual ErrorCode
+  onSymbolicateAddresses(Session &session,
+                         std::vector<uint64_t> const &addresses,
+                         SymbolInfo::Collection &symbols) = 0;
 
   virtual ErrorCode onComputeCRC(Session &session, Address const &address,
                                  size_t length, uint32_t &crc) = 0;
@@ -219,8 +244,9 @@ protected:
   virtual ErrorCode fetchStopInfoForAllThreads(Session &session,
                                                std::vector<StopInfo> &stops,
                                                StopInfo &processStop) = 0;
+  // The JSON array of jstopinfo: the threads that stopped for a reason.
   virtual ErrorCode createThreadsStopInfo(Session &session,
-                                          JSArray &threadsStopInfo) = 0;
+                                          std::string &threadsStopInfo) = 0;
 
 protected: // Platform Session
   virtual ErrorCode onDisableASLR(Session &session, bool disable) = 0;
@@ -15,7 +15,8 @@
 #include "DebugServer2/Types.h"
 #include "JSObjects/JSObjects.h"
 
-#include <set>
+#include <utility>
+#include <vector>
 
 namespace ds2 {
 namespace GDBRemote {
@@ -31,6 +32,28 @@ struct MemoryRegionInfo : public ds2::MemoryRegionInfo {
   std::string encode() const;
 };
 
+struct ModuleInfo : public ds2::ModuleInfo {
+  std::string triple;
+
+  std::string encode() const;
+  JSDictionary *encodeJson() const;
+};
+
+struct ProfileData : public ds2::ProfileData {
+  // The scan_type bits of QSetEnableAsyncProfiling and qGetProfileData.
+  enum ScanType : uint32_t {
+    kScanHostCPU = (1 << 0),
+    kScanCPU = (1 << 1),
+    kScanThreadsCPU = (1 << 2),
+    kScanThreadName = (1 << 3),
+    kScanHostMemory = (1 << 5),
+    kScanMemory = (1 << 6),
+    kScanAll = 0xffffffff
+  };
+
+  std::string encode(uint32_t scanType) const;
+};
+
 struct StopInfo : public ds2::StopInfo {
 public:
   // Allow copying and constructing from a ds2::StopInfo directly.
@@ -38,7 +61,7 @@ public:
   StopInfo(ds2::StopInfo const &info) : ds2::StopInfo(info) {}
   StopInfo &operator=(ds2::StopInfo const &info) {
     clear();
-    new (this) ds2::StopInfo(info);
+    ds2::StopInfo::operator=(info);
     return *this;
   }
 
@@ -46,12 +69,21 @@ public:
   ProcessThreadId ptid;
   std::string threadName;
   Architecture::GPRegisterStopMap registers;
-  std::set<ThreadId> threads;
+  // Registers the debugger asked for on top of `registers`: the register
+  // number and size of each, with their raw bytes back to back in
+  // `expeditedData`.
+  std::vector<std::pair<uint32_t, size_t>> expeditedRegisters;
+  std::string expeditedData;
+  std::vector<ThreadId> threads;
+  // The PC of each thread in `threads`, in the same order, for LLDB.
+  std::vector<uint64_t> threadPCs;
 
 public:
   std::string encode(CompatibilityMode mode, bool listThreads) const;
+  void encode(std::string &out, CompatibilityMode mode,
+              bool listThreads) const;
   std::string encodeWithAllThreads(CompatibilityMode mode,
-                                   const JSArray &threadsStopInfo) const;
+                                   std::string const &threadsStopInfo) const;
   JSDictionary *encodeJson() const;
 
 private:
@@ -59,17 +91,19 @@ private:
                          CompatibilityMode mode, bool encodeHex) const;
   void reasonToString(std::string &key, std::string &val,
                       CompatibilityMode mode) const;
-  std::string encodeInfo(CompatibilityMode mode, bool listThreads) const;
-  void encodeRegisters(std::map<std::string, std::string> &regs,
-                       bool hexIndex) const;
-  std::string encodeRegisters() const;
+  void encodeInfo(std::string &out, CompatibilityMode mode,
+                  bool listThreads) const;
+  void encodeRegisters(std::string &out) const;
 
 public:
   inline void clear() {
     ptid.clear();
     threadName.clear();
     registers.clear();
+    expeditedRegisters.clear();
+    expeditedData.clear();
     threads.clear();
+    threadPCs.clear();
     ds2::StopInfo::clear();
   }
 };
@@ -183,6 +217,12 @@ struct ProcessInfoMatch : public ProcessInfo {
   std::string triple;
   bool allUsers;
   StringCollection keys;
+
+  ProcessInfoMatch() : ProcessInfo(), allUsers(false) {}
+
+  bool hasKey(char const *key) const;
+  bool matchesName(std::string const &path) const;
+  bool matches(ds2::ProcessInfo const &info) const;
 };
 
 struct ServerVersion {
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <asm-generic/unistd.h>
+#include <csignal>
 #include <sys/mman.h>
 
 namespace ds2 {
@@ -98,6 +99,22 @@ static inline void PrepareMunmapCode(uint64_t address, size_t size,
   InsertBytes(codestr, address); // .quad XXXXXXXXXXXXXXXX
   InsertBytes(codestr, size);    // .quad XXXXXXXXXXXXXXXX
 }
+
+// There is no fork syscall on ARM64, use clone(SIGCHLD, 0, 0, 0, 0) instead.
+static inline void PrepareForkCode(ByteVector &codestr) {
+  for (uint32_t instr : {
+           MakeMovImmInstr(8, __NR_clone), // mov x8, __NR_clone
+           MakeMovImmInstr(0, SIGCHLD),    // mov x0, SIGCHLD
+           MakeMovImmInstr(1, 0),          // mov x1, 0
+           MakeMovImmInstr(2, 0),          // mov x2, 0
+           MakeMovImmInstr(3, 0),          // mov x3, 0
+           MakeMovImmInstr(4, 0),          // mov x4, 0
+           MakeSvcInstr(0),                // svc #0
+           MakeBrkInstr(0x100),            // brk #0x100
+       }) {
+    InsertBytes(codestr, instr);
+  }
+}
 } // namespace Syscalls
 } // namespace ARM64
 } // namespace Linux
@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include "DebugServer2/Types.h"
+
+#include <functional>
+#include <map>
+#include <sys/types.h>
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+//
+// Reports processes as soon as they exec. This uses the netlink process
+// connector when we're allowed to (it requires CAP_NET_ADMIN), and falls back
+// to scanning /proc otherwise.
+//
+class ExecWatcher {
+public:
+  typedef std::function<bool(pid_t pid, std::string const &path)> Matcher;
+
+private:
+  int _fd;
+  // Written to by cancel(), from any thread.
+  int _cancelFd;
+  std::map<pid_t, std::string> _processes;
+  bool _started;
+
+public:
+  ExecWatcher();
+  ~ExecWatcher();
+
+public:
+  // Processes that exec before start() is called are never reported.
+  ErrorCode start();
+  ErrorCode wait(Matcher const &matcher, pid_t &pid);
+  // Makes wait() return kErrorInterrupted, even if it has not started yet.
+  void cancel();
+
+public:
+  inline bool usingNetlink() const { return _fd >= 0; }
+
+private:
+  bool subscribe();
+  ErrorCode waitNetlink(Matcher const &matcher, pid_t &pid);
+  ErrorCode waitPolling(Matcher const &matcher, pid_t &pid);
+  bool cancelled(int timeout);
+  bool scan(Matcher const *matcher, pid_t &pid);
+};
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
@@ -112,6 +112,31 @@ static inline int tkill(pid_t tid, int signo) {
   return ::syscall(SYS_tkill, tid, signo);
 }
 
+#if !defined(SYS_perf_event_open)
+#define SYS_perf_event_open __NR_perf_event_open
+#endif // !SYS_perf_event_open
+
+// There is no libc wrapper for `perf_event_open`.
+struct perf_event_attr;
+static inline int perf_event_open(struct perf_event_attr *attr, pid_t tid,
+                                  int cpu, int groupFd, unsigned long flags) {
+  return ::syscall(SYS_perf_event_open, attr, tid, cpu, groupFd, flags);
+}
+
+#if !defined(HAVE_MEMFD_CREATE)
+#if !defined(SYS_memfd_create)
+#define SYS_memfd_create __NR_memfd_create
+#endif // !SYS_memfd_create
+
+#if !defined(MFD_CLOEXEC)
+#define MFD_CLOEXEC 0x0001U
+#endif // !MFD_CLOEXEC
+
+static inline int memfd_create(char const *name, unsigned int flags) {
+  return ::syscall(SYS_memfd_create, name, flags);
+}
+#endif // !HAVE_MEMFD_CREATE
+
 #if !defined(HAVE_SYS_PERSONALITY_H)
 #if !defined(SYS_personality)
 #define SYS_personality __NR_personality
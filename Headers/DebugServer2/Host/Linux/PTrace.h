@@ -28,6 +28,13 @@ public:
   ErrorCode traceMe(bool disableASLR) override;
   ErrorCode traceThat(ProcessId pid) override;
 
+public:
+  ErrorCode attach(ProcessId pid) override;
+  ErrorCode detach(ProcessId pid) override;
+
+protected:
+  long runOnTracer(pid_t pid, std::function<long()> const &request) override;
+
 public:
   ErrorCode kill(ProcessThreadId const &ptid, int signal) override;
 
@@ -52,6 +59,12 @@ public:
                          Architecture::CPUState &state) override;
   ErrorCode writeCPUState(ProcessThreadId const &ptid, ProcessInfo const &pinfo,
                           Architecture::CPUState const &state) override;
+#if defined(ARCH_ARM) || defined(ARCH_X86) || defined(ARCH_X86_64)
+  ErrorCode readGPRState(ProcessThreadId const &ptid, ProcessInfo const &pinfo,
+                         Architecture::CPUState &state) override;
+  ErrorCode writeGPRState(ProcessThreadId const &ptid, ProcessInfo const &pinfo,
+                          Architecture::CPUState const &state) override;
+#endif
 
 private:
   ErrorCode prepareAddressForResume(ProcessThreadId const &ptid,
@@ -66,6 +79,17 @@ public:
 
 public:
   ErrorCode getSigInfo(ProcessThreadId const &ptid, siginfo_t &si) override;
+  // Returns the pid of the new child for fork, vfork and clone events.
+  ErrorCode getEventMessage(ProcessThreadId const &ptid,
+                            unsigned long &message);
+
+protected:
+  bool isEventStop(int status) const override;
+
+public:
+  // Reads a register set as the kernel lays it out in core file notes.
+  ErrorCode readNoteRegisterSet(ProcessThreadId const &ptid, int regSetCode,
+                                ByteVector &data);
 
 protected:
   virtual ErrorCode readRegisterSet(ProcessThreadId const &ptid, int regSetCode,
@@ -111,6 +111,9 @@ public:
   static bool ReadLink(pid_t pid, pid_t tid, char const *what, char *buf,
                        size_t bufsiz);
 
+  // Number of files opened or links read through the functions above.
+  static uint64_t OpenCount();
+
 public:
   static void
   ParseKeyValue(FILE *fp, size_t maxsize, char sep,
@@ -132,16 +135,20 @@ public:
     bool is64Bit;
   };
 
+  static bool ReadELFInfo(char const *path, ELFInfo &info);
   static bool GetProcessELFInfo(pid_t pid, ELFInfo &info);
   static int32_t GetProcessELFMachineType(pid_t pid, bool *is64Bit = nullptr);
   static CPUType GetProcessCPUType(pid_t pid);
 
 public:
   static bool ReadProcessInfo(pid_t pid, ProcessInfo &info);
+  static bool ReadProcessInfo(pid_t pid, std::string const &path,
+                              ProcessInfo &info);
 
 public:
   static std::string GetProcessName(pid_t pid);
   static pid_t GetProcessParentPid(pid_t pid);
+  static pid_t GetThreadTracerPid(pid_t tid);
   static std::string GetThreadName(pid_t pid, pid_t tid);
   static std::string GetProcessExecutableName(pid_t pid);
   static std::string GetProcessExecutablePath(pid_t pid);
@@ -149,8 +156,9 @@ public:
   static std::string GetProcessArgumentsAsString(pid_t pid, bool arg0 = false);
 
 public:
-  static bool EnumerateProcesses(bool allUsers, uid_t uid,
-                                 std::function<void(pid_t, uid_t)> const &cb);
+  static bool
+  EnumerateProcesses(bool allUsers, uid_t uid,
+                     std::function<void(pid_t, std::string const &)> const &cb);
   static bool EnumerateThreads(pid_t pid, std::function<void(pid_t)> const &cb);
 };
 } // namespace Linux
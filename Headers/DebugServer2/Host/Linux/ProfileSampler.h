@@ -0,0 +1,62 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include "DebugServer2/Types.h"
+
+#include <ctime>
+#include <map>
+#include <sys/types.h>
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+//
+// Samples the CPU time, resident size and context switches of a process.
+// This only relies on the pid, so that it can run on a thread other than the
+// one tracing the process, while the process is running. The /proc files
+// that are read on every sample are kept open and re-read from the start.
+//
+class ProfileSampler {
+private:
+  struct ThreadEntry {
+    int schedstatFd; // -1 if unavailable
+    int commFd;
+    bool alive;
+  };
+
+private:
+  pid_t _pid;
+  clockid_t _clock;
+  bool _hasClock;
+  int _statmFd;
+  int _hostStatFd;
+  std::map<pid_t, ThreadEntry> _threads;
+
+public:
+  ProfileSampler(pid_t pid);
+  ~ProfileSampler();
+
+public:
+  inline pid_t pid() const { return _pid; }
+
+public:
+  ErrorCode sample(ProfileData &data);
+
+private:
+  void sampleHost(ProfileData &data);
+  void sampleThreads(ProfileData &data);
+  void closeThread(ThreadEntry const &entry);
+};
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
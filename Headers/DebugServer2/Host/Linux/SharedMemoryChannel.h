@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include "DebugServer2/Host/Channel.h"
+#include "DebugServer2/Host/Socket.h"
+
+#include <memory>
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+//
+// A channel for debuggers running on the same host. Both directions are
+// single-producer single-consumer rings in a shared memfd, so that packets
+// are exchanged without copying them through the kernel. eventfds are only
+// signaled when the other side is about to sleep.
+//
+// The channel is negotiated on a connected UNIX socket: the client sends
+// kHandshake instead of its first packet, and the server answers with the
+// memfd and eventfds. The socket stays open to notice when the other side
+// goes away.
+//
+class SharedMemoryChannel : public Channel,
+                            public make_unique_enabler<SharedMemoryChannel> {
+public:
+  static char const kHandshake[];
+
+private:
+  struct Ring;
+  struct Endpoint {
+    Ring *ring;
+    int dataEvent;  // signaled when the ring gets data
+    int spaceEvent; // signaled when the ring gets free space
+  };
+
+private:
+  Socket *_socket;
+  void *_map;
+  Endpoint _tx;
+  Endpoint _rx;
+  bool _connected;
+
+protected:
+  SharedMemoryChannel(Socket *socket);
+
+public:
+  ~SharedMemoryChannel() override;
+
+public:
+  // Server side: switches to shared memory if the client asks for it, and
+  // returns nullptr, without having consumed anything from the socket,
+  // otherwise.
+  static std::unique_ptr<SharedMemoryChannel> Accept(Socket *socket);
+  // Client side, for tools talking to ds2. There is no separate client
+  // library: such tools build this file along with Host::Socket and the
+  // logging code it relies on.
+  static std::unique_ptr<SharedMemoryChannel> Connect(Socket *socket);
+
+public:
+  void close() override;
+
+public:
+  bool connected() const override { return _connected; }
+
+public:
+  bool wait(int ms = -1) override;
+
+public:
+  ssize_t send(void const *buffer, size_t length) override;
+  ssize_t receive(void *buffer, size_t length) override;
+
+public:
+  bool receive(std::string &buffer) override;
+
+private:
+  bool setup(int memfd, int const events[4], bool server);
+  int sleep(int event, int ms);
+  void wake(Endpoint const &endpoint, bool data);
+};
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
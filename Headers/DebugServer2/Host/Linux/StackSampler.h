@@ -0,0 +1,82 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include "DebugServer2/Types.h"
+
+#include <map>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+//
+// Samples the user-space call stacks of a process with `cpu-clock` perf
+// events, without stopping it. Each thread gets its own event and ring
+// buffer; a background thread drains them and counts identical stacks.
+// Threads are picked up when the buffers are drained, so threads that live
+// less than that aren't sampled.
+//
+class StackSampler {
+public:
+  // Return addresses, outermost frame first; the last one is the sampled PC.
+  typedef std::vector<uint64_t> Stack;
+  typedef std::map<Stack, uint64_t> StackCounts;
+
+private:
+  struct Buffer {
+    int fd;
+    void *map;
+    bool alive;
+  };
+
+private:
+  pid_t _pid;
+  uint32_t _frequency;
+  size_t _pageSize;
+  std::map<pid_t, Buffer> _buffers;
+  std::thread _thread;
+  int _wakeFd;
+
+  std::mutex _lock;
+  StackCounts _stacks;
+  uint64_t _lost;
+
+public:
+  StackSampler(pid_t pid, uint32_t frequency);
+  ~StackSampler();
+
+public:
+  inline pid_t pid() const { return _pid; }
+
+public:
+  ErrorCode start();
+  void stop();
+
+public:
+  // Copies the stacks counted so far and the number of samples that were
+  // dropped because a ring buffer was full.
+  void getStacks(StackCounts &stacks, uint64_t &lost);
+
+private:
+  void samplerThread();
+  void updateThreads();
+  bool openThread(pid_t tid, Buffer &buffer);
+  void closeThread(Buffer const &buffer);
+  void drain(Buffer &buffer);
+};
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include "DebugServer2/Types.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+//
+// ptrace(2) requests on a thread have to come from the thread that traces it.
+// The pool has a number of tracer threads ("shards"); every thread we attach
+// to goes to one of them, and so do the threads it creates since the kernel
+// attaches them to the same tracer. Requests for a thread are executed on its
+// tracer, and work that has to be done for many threads (e.g.: collecting the
+// stops of a whole process) runs on all shards in parallel.
+//
+// Threads we didn't attach through the pool (e.g.: those of a process we
+// launched) stay with the thread that created the pool.
+//
+class TracerPool {
+public:
+  typedef std::function<long()> Request;
+
+private:
+  struct Shard {
+    std::thread thread;
+    pid_t tid;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  // The index used for the thread that created the pool.
+  static int const kMainTracer = -1;
+
+private:
+  std::vector<std::unique_ptr<Shard>> _shards;
+  std::map<pid_t, int> _tracers;
+  std::mutex _tracersLock;
+  size_t _nextShard;
+  bool _terminated;
+
+public:
+  TracerPool(size_t numShards);
+  ~TracerPool();
+
+public:
+  // Creates the pool used by every Linux::PTrace instance. Must be called
+  // before any process is created or attached.
+  static void Initialize(size_t numShards);
+  static TracerPool *Get();
+
+public:
+  inline size_t size() const { return _shards.size(); }
+
+public:
+  // Runs `request` on the thread that traces `tid` and returns its result.
+  // errno is carried over from that thread.
+  long run(pid_t tid, Request const &request);
+
+  // Calls `cb` for every element of `tids`, on the thread that traces it.
+  // Shards run in parallel; this returns once all of them are done.
+  void runGrouped(std::vector<pid_t> const &tids,
+                  std::function<void(pid_t)> const &cb);
+
+public:
+  // Attaches to `tid` from the next shard, in round-robin order.
+  long attach(pid_t tid, Request const &request);
+  void forget(pid_t tid);
+
+private:
+  int tracerOf(pid_t tid);
+  void post(int shard, std::function<void()> const &task);
+  void shardThread(int index);
+};
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
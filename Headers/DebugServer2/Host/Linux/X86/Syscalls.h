@@ -38,6 +38,12 @@ static uint8_t const gMunmapCode[] = {
     0xcd, 0x80,                   // 0f: int  $0x80
     0xcc                          // 10: int3
 };
+
+static uint8_t const gForkCode[] = {
+    0xb8, 0x00, 0x00, 0x00, 0x00, // 00: movl $sysno, %eax
+    0xcd, 0x80,                   // 05: int  $0x80
+    0xcc                          // 07: int3
+};
 } // namespace
 
 static inline void PrepareMmapCode(size_t size, int protection,
@@ -60,6 +66,13 @@ static inline void PrepareMunmapCode(uint32_t address, size_t size,
   *reinterpret_cast<uint32_t *>(code + 0x06) = address;
   *reinterpret_cast<uint32_t *>(code + 0x0b) = size;
 }
+
+static inline void PrepareForkCode(ByteVector &codestr) {
+  codestr.assign(&gForkCode[0], &gForkCode[sizeof(gForkCode)]);
+
+  uint8_t *code = &codestr[0];
+  *reinterpret_cast<uint32_t *>(code + 0x01) = 2; // __NR_fork
+}
 } // namespace Syscalls
 } // namespace X86
 } // namespace Linux
@@ -39,6 +39,12 @@ static uint8_t const gMunmapCode[] = {
     0x0f, 0x05,                               // 18: syscall
     0xcc                                      // 1a: int3
 };
+
+static uint8_t const gForkCode[] = {
+    0x48, 0xc7, 0xc0, 0x00, 0x00, 0x00, 0x00, // 00: movq $sysno, %rax
+    0x0f, 0x05,                               // 07: syscall
+    0xcc                                      // 09: int3
+};
 } // namespace
 
 static inline void PrepareMmapCode(size_t size, int protection,
@@ -61,6 +67,13 @@ static inline void PrepareMunmapCode(uint64_t address, size_t size,
   *reinterpret_cast<uint64_t *>(code + 0x09) = address;
   *reinterpret_cast<uint32_t *>(code + 0x14) = size;
 }
+
+static inline void PrepareForkCode(ByteVector &codestr) {
+  codestr.assign(&gForkCode[0], &gForkCode[sizeof(gForkCode)]);
+
+  uint8_t *code = &codestr[0];
+  *reinterpret_cast<uint32_t *>(code + 0x03) = 57; // __NR_fork
+}
 } // namespace Syscalls
 } // namespace X86_64
 } // namespace Linux
@@ -16,6 +16,7 @@
 
 #include <cerrno>
 #include <csignal>
+#include <functional>
 // clang-format off
 #include <sys/types.h>
 #include <sys/ptrace.h>
@@ -62,6 +63,20 @@ public:
                                   ProcessInfo const &info,
                                   Architecture::CPUState const &state) = 0;
 
+  // Only the general purpose registers, which is all we need to know where a
+  // thread stopped. Hosts where this is cheaper than the full state override
+  // these.
+  virtual ErrorCode readGPRState(ProcessThreadId const &ptid,
+                                 ProcessInfo const &info,
+                                 Architecture::CPUState &state) {
+    return readCPUState(ptid, info, state);
+  }
+  virtual ErrorCode writeGPRState(ProcessThreadId const &ptid,
+                                  ProcessInfo const &info,
+                                  Architecture::CPUState const &state) {
+    return writeCPUState(ptid, info, state);
+  }
+
 public:
   virtual ErrorCode suspend(ProcessThreadId const &ptid);
 
@@ -84,6 +99,11 @@ public:
                             ProcessInfo const &pinfo, void const *code,
                             size_t length, uint64_t &result);
 
+protected:
+  // Stops that only notify the tracer of something (e.g.: ptrace events on
+  // Linux). execute() resumes through them.
+  virtual bool isEventStop(int status) const { return false; }
+
 #if defined(OS_LINUX)
 #if defined(ARCH_ARM) || defined(ARCH_ARM64)
 public:
@@ -106,6 +126,12 @@ public:
 #endif // OS_LINUX
 
 protected:
+  // Runs a ptrace(2) request for `pid` on the thread that is allowed to make
+  // it, which is the calling thread unless the platform decides otherwise.
+  virtual long runOnTracer(pid_t pid, std::function<long()> const &request) {
+    return request();
+  }
+
   template <typename CommandType, typename AddrType, typename DataType>
   long wrapPtrace(CommandType request, pid_t pid, AddrType addr, DataType data,
                   int retries = 3) {
@@ -135,14 +161,16 @@ protected:
                Stringify::PTraceCommand(request), pid, Stringify::Errno(errno));
       }
 
-      // Clear errno so we can check it afterwards. Just checking the return
-      // value of ptrace won't work because PTRACE_PEEK* commands return the
-      // value read instead of 0 or -1.
-      errno = 0;
+      ret = runOnTracer(pid, [&]() -> long {
+        // Clear errno so we can check it afterwards. Just checking the return
+        // value of ptrace won't work because PTRACE_PEEK* commands return the
+        // value read instead of 0 or -1.
+        errno = 0;
 
-      ret = ::ptrace(static_cast<PTraceRequestType>(request), pid,
-                     (PTraceAddrType)(uintptr_t)addr,
-                     (PTraceDataType)(uintptr_t)data);
+        return ::ptrace(static_cast<PTraceRequestType>(request), pid,
+                        (PTraceAddrType)(uintptr_t)addr,
+                        (PTraceDataType)(uintptr_t)data);
+      });
     } while (ret < 0 && (errno == EAGAIN || errno == EBUSY) && retries > 0);
 
     if (errno != 0) {
@@ -74,6 +74,12 @@ public:
   static void
   EnumerateProcesses(bool allUsers, UserId const &uid,
                      std::function<void(ProcessInfo const &info)> const &cb);
+  // `filter` sees the pid and executable path of each process before
+  // anything else is read about it; processes it rejects are skipped.
+  static void EnumerateProcesses(
+      bool allUsers, UserId const &uid,
+      std::function<bool(ProcessId pid, std::string const &path)> const &filter,
+      std::function<void(ProcessInfo const &info)> const &cb);
 
 public:
   static std::string GetThreadName(ProcessId pid, ThreadId tid);
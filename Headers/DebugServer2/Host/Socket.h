@@ -49,6 +49,7 @@ public:
 
 public:
   inline bool valid() const { return (_handle != INVALID_SOCKET); }
+  inline SOCKET handle() const { return _handle; }
 
 public:
   inline bool listening() const { return (_state == kStateListening); }
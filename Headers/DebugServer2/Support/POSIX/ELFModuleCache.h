@@ -0,0 +1,33 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include "DebugServer2/Types.h"
+
+namespace ds2 {
+namespace Support {
+
+//
+// Build ID, digest and architecture of the files the debugger asks about.
+// Files are mapped rather than read, and what we find is kept for the
+// lifetime of the server (i.e.: across sessions) for as long as the file's
+// device, inode, size and modification time stay the same.
+//
+// Hashing reads the whole file, so the digest is only computed for files
+// without a build ID, unless `needMD5` asks for it; it is zero otherwise.
+//
+class ELFModuleCache {
+public:
+  static ErrorCode GetModuleInfo(std::string const &path, ModuleInfo &info,
+                                 bool needMD5 = false);
+};
+} // namespace Support
+} // namespace ds2
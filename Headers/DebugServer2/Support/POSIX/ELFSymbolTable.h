@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include "DebugServer2/Types.h"
+
+#include <memory>
+
+namespace ds2 {
+namespace Support {
+
+//
+// Function and object symbols of an ELF file, from .symtab or, for stripped
+// files, .dynsym. Addresses are link-time addresses (i.e.: without the load
+// bias) and are kept sorted in their own array so that lookups only touch a
+// few cache lines.
+//
+class ELFSymbolTable {
+private:
+  uint64_t _lowAddress;
+  uint64_t _highAddress;
+  std::vector<uint64_t> _starts;
+  std::vector<uint64_t> _ends;
+  std::vector<uint32_t> _names;
+  std::string _strings;
+
+public:
+  ELFSymbolTable();
+
+public:
+  // Tables are parsed once per version of a file and shared for the lifetime
+  // of the server.
+  static ErrorCode Get(std::string const &path,
+                       std::shared_ptr<ELFSymbolTable const> &table);
+
+public:
+  // Range covered by the loadable segments of the file.
+  inline uint64_t lowAddress() const { return _lowAddress; }
+  inline uint64_t highAddress() const { return _highAddress; }
+  inline size_t count() const { return _starts.size(); }
+
+public:
+  bool lookup(uint64_t address, char const *&name, uint64_t &offset) const;
+
+private:
+  template <typename Ehdr, typename Phdr, typename Shdr, typename Sym>
+  void load(uint8_t const *image, size_t size);
+};
+} // namespace Support
+} // namespace ds2
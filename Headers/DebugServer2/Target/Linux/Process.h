@@ -13,18 +13,82 @@
 #include "DebugServer2/Host/Linux/PTrace.h"
 #include "DebugServer2/Target/POSIX/ELFProcess.h"
 
+#include <deque>
+#include <map>
+
 namespace ds2 {
 namespace Target {
 namespace Linux {
 
 class Process : public POSIX::ELFProcess {
+public:
+  // Events that are reported to the debugger instead of being handled
+  // silently.
+  enum {
+    kReportFork = (1 << 0),
+    kReportVFork = (1 << 1),
+    kReportExec = (1 << 2),
+  };
+
 protected:
   Host::Linux::PTrace _ptrace;
+  uint32_t _reportedEvents;
+  bool _detachOnFork;
+  // Children we are still tracing after a fork, with the status of their
+  // initial stop, until someone adopts them.
+  std::map<ProcessId, int> _forkedChildren;
+  // Set from a vfork until its vforkdone: the child runs in our address
+  // space, where it must not find our breakpoints. While they are inserted,
+  // the trap instructions we took out are kept here.
+  bool _vforkPending;
+  std::map<uint64_t, ByteVector> _vforkTraps;
+  // Statuses of our threads reaped by the wait() of another process.
+  std::deque<std::pair<pid_t, int>> _strayStatuses;
+  bool _trackDirtyPages;
+  MemoryRange::Collection _dirtyRanges;
+  // Memory fetched ahead of sequential or strided reads, only valid until
+  // the process resumes or its memory is written to.
+  struct {
+    uint64_t start;
+    ByteVector data;
+    uint64_t lastAddress;
+    uint64_t lastEnd;
+    int64_t stride;
+    size_t streak;
+    size_t size;
+  } _readAhead;
+  // /proc/<pid>/mem, opened on first use; -2 if it can't be.
+  int _memFd;
+  // ProcFS::OpenCount() at the last stop.
+  uint64_t _procFSOpens;
+
+public:
+  Process();
+  ~Process() override;
 
 protected:
   ErrorCode attach(int waitStatus) override;
 
 public:
+  inline void setReportedEvents(uint32_t events) { _reportedEvents = events; }
+  inline void setDetachOnFork(bool detach) { _detachOnFork = detach; }
+
+public:
+  // Returns a new Process for one of the children we kept tracing after a
+  // fork, or nullptr if there is none left.
+  ds2::Target::Process *adoptForkedChild();
+
+  // Takes a snapshot of the stopped process: a copy of it, with only the
+  // current thread, that stays stopped until it is resumed in its place.
+  ErrorCode checkpoint(ds2::Target::Process *&snapshot);
+
+protected:
+  ds2::Target::Process *adoptChild(ProcessId childPid, int status);
+  // Arch-specific code for executeCode() that forks the process.
+  ErrorCode prepareForkCode(ByteVector &codestr);
+
+public:
+  ErrorCode suspend() override;
   ErrorCode terminate() override;
   bool isAlive() const override;
 
@@ -48,15 +112,47 @@ public:
 
 protected:
   ErrorCode checkMemoryErrorCode(uint64_t address);
+  bool readAhead(uint64_t address, void *data, size_t length);
+  void invalidateReadAhead();
+  bool writeMemFile(uint64_t address, void const *data, size_t length);
 
 public:
   ErrorCode wait() override;
 
+public:
+  ErrorCode saveCore(std::string &path, bool unique) override;
+
+public:
+  ErrorCode enableDirtyPageTracking(bool enable) override;
+  ErrorCode
+  getDirtyMemoryRanges(MemoryRange::Collection &ranges) const override;
+  ErrorCode beforeResume() override;
+  ErrorCode afterResume() override;
+
+protected:
+  ErrorCode clearSoftDirtyBits();
+  ErrorCode collectDirtyPages();
+
 public:
   Host::POSIX::PTrace &ptrace() const override;
 
+protected:
+  // Processes are waited for with waitpid(-1), which reaps the statuses of
+  // every tracee; these are the ones they can belong to.
+  static std::map<ProcessId, Process *> sProcesses;
+  static Process *FindOwner(pid_t tid, int status, bool &forkedChild);
+
+protected:
+  bool handleFork(StopInfo const &stopInfo);
+  void removeVForkTraps();
+  void restoreVForkTraps();
+  void handleExec();
+
 protected:
   ErrorCode updateInfo() override;
+
+public:
+  ErrorCode getCurrentInfo(ProcessInfo &info) override;
   ErrorCode updateAuxiliaryVector() override;
 
 protected:
@@ -73,6 +169,9 @@ public:
   int getMaxWatchpointSize() const override;
 #endif
 
+protected:
+  void removeThread(ThreadId tid) override;
+
 protected:
   friend class POSIX::Process;
 };
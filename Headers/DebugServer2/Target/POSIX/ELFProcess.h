@@ -11,16 +11,35 @@
 #pragma once
 
 #include "DebugServer2/Support/POSIX/ELFSupport.h"
+#include "DebugServer2/Support/POSIX/ELFSymbolTable.h"
 #include "DebugServer2/Target/POSIX/Process.h"
 
+#include <memory>
+
 namespace ds2 {
 namespace Target {
 namespace POSIX {
 
 class ELFProcess : public POSIX::Process {
+protected:
+  struct LoadedModule {
+    std::string path;
+    uint64_t bias;
+    uint64_t start;
+    uint64_t end;
+    std::shared_ptr<Support::ELFSymbolTable const> symbols;
+  };
+
 protected:
   std::string _auxiliaryVector;
   Address _sharedLibraryInfoAddress;
+  // Sorted by start address, rebuilt the first time it's needed after the
+  // process has run.
+  std::vector<LoadedModule> _loadedModules;
+  bool _loadedModulesValid;
+
+protected:
+  ELFProcess();
 
 public:
   ErrorCode getAuxiliaryVector(std::string &auxv) override;
@@ -36,9 +55,17 @@ public:
       std::function<
           void(Support::ELFSupport::AuxiliaryVectorEntry const &)> const &cb);
 
+public:
+  ErrorCode symbolicate(std::vector<uint64_t> const &addresses,
+                        SymbolInfo::Collection &symbols) override;
+
+public:
+  ErrorCode beforeResume() override;
+
 protected:
   ErrorCode updateInfo() override;
   virtual ErrorCode updateAuxiliaryVector();
+  ErrorCode updateLoadedModules();
 };
 } // namespace POSIX
 } // namespace Target
@@ -23,6 +23,8 @@ protected:
 public:
   ErrorCode readCPUState(Architecture::CPUState &state) override;
   ErrorCode writeCPUState(Architecture::CPUState const &state) override;
+  ErrorCode readGPRState(Architecture::CPUState &state) override;
+  ErrorCode writeGPRState(Architecture::CPUState const &state) override;
 
 public:
   ErrorCode terminate() override;
@@ -64,6 +64,11 @@ protected:
 
 public:
   virtual ErrorCode getInfo(ProcessInfo &info);
+  // Same as above without copying; stays valid until the process execs.
+  ErrorCode getInfo(ProcessInfo const *&info);
+  // Same as getInfo, with up to date parent, user and group ids, which can
+  // change without an exec.
+  virtual ErrorCode getCurrentInfo(ProcessInfo &info);
 
 public: // ELF only
   virtual ErrorCode getAuxiliaryVector(std::string &auxv);
@@ -126,6 +131,10 @@ public:
 
 public:
   virtual void getThreadIds(std::vector<ThreadId> &tids);
+  // Up to `count` thread ids, in increasing order, starting after `lastTid`
+  // or at the first one if it's kAllThreadId.
+  void getThreadIds(ThreadId lastTid, size_t count,
+                    std::vector<ThreadId> &tids) const;
 
 protected:
   virtual ErrorCode updateInfo() = 0;
@@ -144,6 +153,33 @@ public:
   virtual int getMaxWatchpoints() const { return 0; }
   virtual int getMaxWatchpointSize() const { return 0; }
 
+public:
+  // Writes an ELF core file of the (stopped) process to `path`. When
+  // `unique` is set, `path` is a mkstemp(3) template that is replaced with
+  // the name of the file that was created.
+  virtual ErrorCode saveCore(std::string &path, bool unique) {
+    return kErrorUnsupported;
+  }
+
+public:
+  // When enabled, the pages written to while the process runs are recorded
+  // and can be queried once it stops.
+  virtual ErrorCode enableDirtyPageTracking(bool enable) {
+    return kErrorUnsupported;
+  }
+  virtual ErrorCode
+  getDirtyMemoryRanges(MemoryRange::Collection &ranges) const {
+    return kErrorUnsupported;
+  }
+
+public:
+  // Finds the module and symbol each of `addresses` falls in, using the
+  // symbol tables of the module files on the host.
+  virtual ErrorCode symbolicate(std::vector<uint64_t> const &addresses,
+                                SymbolInfo::Collection &symbols) {
+    return kErrorUnsupported;
+  }
+
 public:
   // There shouldn't be any reason for these to be overridden.
   virtual Architecture::GDBDescriptor const *
@@ -61,6 +61,14 @@ public:
 public:
   virtual ErrorCode readCPUState(Architecture::CPUState &state) = 0;
   virtual ErrorCode writeCPUState(Architecture::CPUState const &state) = 0;
+  // Only the general purpose registers (pc, sp, flags, ...) are valid in
+  // `state`; this is what stop handling uses when the rest isn't needed.
+  virtual ErrorCode readGPRState(Architecture::CPUState &state) {
+    return readCPUState(state);
+  }
+  virtual ErrorCode writeGPRState(Architecture::CPUState const &state) {
+    return writeCPUState(state);
+  }
   virtual ErrorCode modifyRegisters(
       std::function<void(Architecture::CPUState &state)> action) final;
 
@@ -146,6 +146,10 @@ struct StopInfo {
     kReasonThreadSpawn,
     kReasonThreadEntry,
     kReasonThreadExit,
+    kReasonFork,
+    kReasonVFork,
+    kReasonVForkDone,
+    kReasonExec,
 #if defined(OS_WIN32)
     kReasonMemoryError,
     kReasonMemoryAlignment,
@@ -171,6 +175,11 @@ struct StopInfo {
   Address watchpointAddress;
   int watchpointIndex;
 
+  // Only valid for kReasonFork and kReasonVFork.
+  ProcessId childPid;
+  // Only valid for kReasonExec.
+  std::string execPath;
+
   StopInfo() { clear(); }
 
   inline void clear() {
@@ -184,6 +193,8 @@ struct StopInfo {
     core = -1;
     watchpointAddress = 0;
     watchpointIndex = -1;
+    childPid = kAnyProcessId;
+    execPath.clear();
   }
 };
 
@@ -341,6 +352,16 @@ struct MemoryRegionInfo {
   }
 };
 
+//
+// A range of memory, e.g.: pages written to since the process was resumed.
+//
+struct MemoryRange {
+  typedef std::vector<MemoryRange> Collection;
+
+  uint64_t start;
+  uint64_t length;
+};
+
 struct SharedLibraryInfo {
   std::string path;
   bool main;
@@ -357,4 +378,72 @@ struct MappedFileInfo {
   uint64_t baseAddress;
   uint64_t size;
 };
+
+//
+// The symbol an address falls in.
+//
+struct SymbolInfo {
+  typedef std::vector<SymbolInfo> Collection;
+
+  std::string module; // empty if the address isn't in a known module
+  std::string name;   // empty if the address isn't in a known symbol
+  uint64_t offset;    // from the symbol, the load bias or 0, in that order
+
+  inline void clear() {
+    module.clear();
+    name.clear();
+    offset = 0;
+  }
+};
+
+//
+// Identifies a module file on the host, so that the debugger can find a
+// matching local copy instead of downloading it.
+//
+struct ModuleInfo {
+  std::string path;
+  ByteVector buildId; // NT_GNU_BUILD_ID, empty if the file has none
+  uint8_t md5[16];
+  CPUType cpuType;
+  CPUSubType cpuSubType;
+  uint64_t fileOffset;
+  uint64_t fileSize;
+};
+
+//
+// A sample of the resources used by a process. Times are in microseconds,
+// sizes in bytes; host CPU times are in clock ticks.
+//
+struct ProfileData {
+  struct ThreadData {
+    typedef std::vector<ThreadData> Collection;
+
+    ThreadId tid;
+    std::string name;
+    uint64_t usedTime;
+    uint64_t contextSwitches;
+  };
+
+  uint32_t cpuCount;
+  uint64_t physicalMemory;
+  uint64_t hostUserTicks;
+  uint64_t hostSystemTicks;
+  uint64_t hostIdleTicks;
+  uint64_t elapsedTime; // wall clock time at which the sample was taken
+  uint64_t usedTime;
+  uint64_t residentSize;
+  uint64_t contextSwitches;
+  ThreadData::Collection threads;
+
+  inline void clear() {
+    cpuCount = 0;
+    physicalMemory = 0;
+    hostUserTicks = hostSystemTicks = hostIdleTicks = 0;
+    elapsedTime = 0;
+    usedTime = 0;
+    residentSize = 0;
+    contextSwitches = 0;
+    threads.clear();
+  }
+};
 } // namespace ds2
@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ds2 {
+namespace Utils {
+
+//
+// RFC 1321 message digest, used to identify files on the host.
+//
+class MD5 {
+public:
+  static size_t const kDigestSize = 16;
+
+private:
+  uint32_t _state[4];
+  uint64_t _length;
+  uint8_t _buffer[64];
+
+public:
+  MD5();
+
+public:
+  void update(void const *data, size_t length);
+  void finalize(uint8_t digest[kDigestSize]);
+
+private:
+  void transform(uint8_t const block[64]);
+};
+} // namespace Utils
+} // namespace ds2
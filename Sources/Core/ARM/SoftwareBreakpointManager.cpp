@@ -88,14 +88,14 @@ void SoftwareBreakpointManager::enumerate(
 
 int SoftwareBreakpointManager::hit(Target::Thread *thread, Site &site) {
   ds2::Architecture::CPUState state;
-  thread->readCPUState(state);
+  thread->readGPRState(state);
 #if defined(OS_WIN32)
   state.setPC(state.pc() - 2);
   if (super::hit(state.pc(), site)) {
     //
     // Move the PC back to the instruction
     //
-    if (thread->writeCPUState(state) != kSuccess) {
+    if (thread->writeGPRState(state) != kSuccess) {
       abort();
     }
     return 0;
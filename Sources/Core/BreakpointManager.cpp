@@ -127,7 +127,7 @@ void BreakpointManager::enable(Target::Thread *thread) {
     DS2LOG(Warning, "double-enabling breakpoints");
   }
 
-  enumerate([this, thread](Site const &site) { enableLocation(site, thread); });
+  enableLocations(thread);
 }
 
 void BreakpointManager::disable(Target::Thread *thread) {
@@ -135,8 +135,7 @@ void BreakpointManager::disable(Target::Thread *thread) {
     DS2LOG(Warning, "double-disabling breakpoints");
   }
 
-  enumerate(
-      [this, thread](Site const &site) { disableLocation(site, thread); });
+  disableLocations(thread);
 
   //
   // Remove temporary breakpoints.
@@ -155,6 +154,15 @@ void BreakpointManager::disable(Target::Thread *thread) {
   }
 }
 
+void BreakpointManager::enableLocations(Target::Thread *thread) {
+  enumerate([this, thread](Site const &site) { enableLocation(site, thread); });
+}
+
+void BreakpointManager::disableLocations(Target::Thread *thread) {
+  enumerate(
+      [this, thread](Site const &site) { disableLocation(site, thread); });
+}
+
 bool BreakpointManager::hit(Address const &address, Site &site) {
   if (!address.valid())
     return false;
@@ -40,6 +40,7 @@ void SessionThread::run() {
     _pp.parse(data);
   }
 
+  _session->onDisconnect();
   _channel->close();
 }
 
@@ -11,12 +11,17 @@
 #define __DS2_LOG_CLASS_NAME__ "SoftwareBreakpointManager"
 
 #include "DebugServer2/Core/SoftwareBreakpointManager.h"
+#include "DebugServer2/Host/Platform.h"
 #include "DebugServer2/Target/Process.h"
 #include "DebugServer2/Target/Thread.h"
 #include "DebugServer2/Utils/HexValues.h"
 #include "DebugServer2/Utils/Log.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
+
+using ds2::Host::Platform;
 
 #define super ds2::BreakpointManager
 
@@ -94,6 +99,160 @@ ErrorCode SoftwareBreakpointManager::disableLocation(Site const &site,
   return kSuccess;
 }
 
+void SoftwareBreakpointManager::groupSitesByPage(
+    std::vector<std::vector<Site>> &groups) const {
+  std::vector<Site> sites;
+  enumerate([&sites](Site const &site) { sites.push_back(site); });
+  std::sort(sites.begin(), sites.end(), [](Site const &a, Site const &b) {
+    return a.address.value() < b.address.value();
+  });
+
+  uint64_t pageMask = ~static_cast<uint64_t>(Platform::GetPageSize() - 1);
+  for (auto const &site : sites) {
+    if (groups.empty() || (groups.back().front().address.value() & pageMask) !=
+                              (site.address.value() & pageMask)) {
+      groups.emplace_back();
+    }
+    groups.back().push_back(site);
+  }
+}
+
+//
+// Inserting breakpoints one by one costs a read and a write each, and on
+// targets where small writes are done a word at a time, several system
+// calls. Breakpoints are instead inserted a page at a time: the span of
+// memory they cover is read once, patched, and written back at once.
+// Groups that can't be read or written fall back to one site at a time.
+//
+void SoftwareBreakpointManager::enableLocations(Target::Thread *thread) {
+  if (thread != nullptr) {
+    DS2LOG(Warning, "thread-specific software breakpoints are unsupported");
+  }
+
+  std::vector<std::vector<Site>> groups;
+  groupSitesByPage(groups);
+
+  for (auto const &group : groups) {
+    uint64_t start = group.front().address.value();
+    uint64_t end = start;
+    for (auto const &site : group) {
+      end = std::max(end, site.address.value() + site.size);
+    }
+
+    ByteVector buffer(end - start);
+    bool success = (_process->readMemory(start, buffer.data(),
+                                         buffer.size()) == kSuccess);
+
+    std::map<uint64_t, ByteVector> insns;
+    for (auto const &site : group) {
+      if (!success)
+        break;
+
+      ByteVector opcode;
+      getOpcode(site.size, opcode);
+      if (site.address.value() + opcode.size() > end) {
+        success = false;
+        break;
+      }
+
+      auto it = buffer.begin() + (site.address.value() - start);
+      insns[site.address] = ByteVector(it, it + opcode.size());
+      std::copy(opcode.begin(), opcode.end(), it);
+    }
+
+    if (success) {
+      success = (_process->writeMemory(start, buffer.data(), buffer.size()) ==
+                 kSuccess);
+    }
+
+    if (!success) {
+      for (auto const &site : group) {
+        auto insn = insns.find(site.address.value());
+        if (insn == insns.end()) {
+          enableLocation(site);
+          continue;
+        }
+
+        // The write may have gone through in part, so memory can't be read
+        // back for the original instruction; use the one we already have.
+        ByteVector opcode;
+        getOpcode(site.size, opcode);
+        if (_process->writeMemory(site.address, opcode.data(),
+                                  opcode.size()) != kSuccess) {
+          DS2LOG(Error,
+                 "cannot enable breakpoint at %" PRI_PTR
+                 ", writeMemory failed",
+                 PRI_PTR_CAST(site.address.value()));
+          continue;
+        }
+        _insns[site.address] = insn->second;
+      }
+      continue;
+    }
+
+    DS2LOG(Debug,
+           "set %" PRIu64 " breakpoints between %" PRI_PTR " and %" PRI_PTR,
+           (uint64_t)group.size(), PRI_PTR_CAST(start), PRI_PTR_CAST(end));
+    for (auto &insn : insns) {
+      _insns[insn.first] = std::move(insn.second);
+    }
+  }
+}
+
+void SoftwareBreakpointManager::disableLocations(Target::Thread *thread) {
+  if (thread != nullptr) {
+    DS2LOG(Warning, "thread-specific software breakpoints are unsupported");
+  }
+
+  std::vector<std::vector<Site>> groups;
+  groupSitesByPage(groups);
+
+  for (auto const &group : groups) {
+    uint64_t start = group.front().address.value();
+    uint64_t end = start;
+    for (auto const &site : group) {
+      auto it = _insns.find(site.address);
+      if (it != _insns.end()) {
+        end = std::max(end, site.address.value() + it->second.size());
+      }
+    }
+
+    if (end == start)
+      continue;
+
+    ByteVector buffer(end - start);
+    bool success = (_process->readMemory(start, buffer.data(),
+                                         buffer.size()) == kSuccess);
+
+    // In reverse, so that overlapping breakpoints are undone in order.
+    if (success) {
+      for (auto it = group.rbegin(); it != group.rend(); ++it) {
+        auto insn = _insns.find(it->address);
+        if (insn != _insns.end()) {
+          std::copy(insn->second.begin(), insn->second.end(),
+                    buffer.begin() + (it->address.value() - start));
+        }
+      }
+      success = (_process->writeMemory(start, buffer.data(), buffer.size()) ==
+                 kSuccess);
+    }
+
+    if (!success) {
+      for (auto const &site : group) {
+        disableLocation(site);
+      }
+      continue;
+    }
+
+    DS2LOG(Debug,
+           "reset %" PRIu64 " instructions between %" PRI_PTR " and %" PRI_PTR,
+           (uint64_t)group.size(), PRI_PTR_CAST(start), PRI_PTR_CAST(end));
+    for (auto const &site : group) {
+      _insns.erase(site.address);
+    }
+  }
+}
+
 void SoftwareBreakpointManager::enable(Target::Thread *thread) {
   super::enable(thread);
 
@@ -114,6 +273,13 @@ bool SoftwareBreakpointManager::enabled(Target::Thread *thread) const {
   return _enabled;
 }
 
+void SoftwareBreakpointManager::enumerateSavedInstructions(
+    std::function<void(Address const &, ByteVector const &)> const &cb) const {
+  for (auto const &insn : _insns) {
+    cb(insn.first, insn.second);
+  }
+}
+
 bool SoftwareBreakpointManager::fillStopInfo(Target::Thread *thread,
                                              StopInfo &stopInfo) {
   BreakpointManager::Site site;
@@ -29,7 +29,7 @@ int SoftwareBreakpointManager::hit(Target::Thread *thread, Site &site) {
   if (thread->state() == Target::Thread::kStepped)
     return 0;
 
-  thread->readCPUState(state);
+  thread->readGPRState(state);
   state.setPC(state.pc() - 1);
 
   if (super::hit(state.pc(), site)) {
@@ -37,13 +37,9 @@ int SoftwareBreakpointManager::hit(Target::Thread *thread, Site &site) {
     // Move the PC back to the instruction, INT3 will move
     // the instruction pointer to the next byte.
     //
-    if (thread->writeCPUState(state) != kSuccess)
+    if (thread->writeGPRState(state) != kSuccess)
       abort();
 
-    uint64_t ex = state.pc();
-    thread->readCPUState(state);
-    DS2ASSERT(ex == state.pc());
-
     return 0;
   }
   return -1;
@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "DebugServerPool"
+
+#include "DebugServer2/GDBRemote/DebugServerPool.h"
+#include "DebugServer2/Host/Platform.h"
+#include "DebugServer2/Host/ProcessSpawner.h"
+#include "DebugServer2/Utils/Log.h"
+#include "DebugServer2/Utils/Stringify.h"
+
+#include <chrono>
+#include <csignal>
+#include <sstream>
+
+using ds2::Host::Platform;
+using ds2::Host::ProcessSpawner;
+using ds2::Utils::Stringify;
+
+namespace ds2 {
+namespace GDBRemote {
+
+static bool IsServerAlive(DebugServerPool::Server const &server) {
+#if defined(OS_POSIX)
+  return ::kill(server.pid, 0) == 0;
+#else
+  return true;
+#endif
+}
+
+static void KillServer(DebugServerPool::Server const &server) {
+#if defined(OS_POSIX)
+  ::kill(server.pid, SIGTERM);
+#endif
+}
+
+DebugServerPool::DebugServerPool(size_t size)
+    : _size(size), _terminated(false) {}
+
+DebugServerPool::~DebugServerPool() { stop(); }
+
+void DebugServerPool::start() {
+  if (_thread.joinable())
+    return;
+
+  _terminated = false;
+  _thread = std::thread(&DebugServerPool::run, this);
+}
+
+void DebugServerPool::stop() {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _terminated = true;
+  }
+  _cond.notify_all();
+
+  if (_thread.joinable())
+    _thread.join();
+
+  // Servers that were never handed out are sitting in accept(), nobody is
+  // going to connect to them anymore.
+  for (auto const &server : _servers) {
+    KillServer(server);
+  }
+  _servers.clear();
+}
+
+ErrorCode DebugServerPool::acquire(uint16_t &port, ProcessId &pid) {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    while (!_servers.empty()) {
+      Server server = _servers.front();
+      _servers.pop_front();
+
+      if (!IsServerAlive(server)) {
+        DS2LOG(Warning, "pooled debug server %d is gone, skipping",
+               server.pid);
+        continue;
+      }
+
+      DS2LOG(Debug, "handing out pooled debug server %d on port %u",
+             server.pid, server.port);
+      port = server.port;
+      pid = server.pid;
+      _cond.notify_all();
+      return kSuccess;
+    }
+  }
+
+  // The pool has been drained faster than we could refill it, fall back to
+  // launching a server synchronously.
+  _cond.notify_all();
+  return Launch(port, pid);
+}
+
+void DebugServerPool::run() {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  for (;;) {
+    _cond.wait(lock, [this] { return _terminated || _servers.size() < _size; });
+    if (_terminated)
+      break;
+
+    Server server;
+    lock.unlock();
+    ErrorCode error = Launch(server.port, server.pid);
+    lock.lock();
+
+    if (error != kSuccess) {
+      DS2LOG(Error, "cannot launch pooled debug server: %s",
+             Stringify::Error(error));
+      // Don't spin if launching is failing for good.
+      _cond.wait_for(lock, std::chrono::seconds(1),
+                     [this] { return _terminated; });
+      continue;
+    }
+
+    if (_terminated) {
+      KillServer(server);
+      break;
+    }
+
+    _servers.push_back(server);
+  }
+}
+
+ErrorCode DebugServerPool::Launch(uint16_t &port, ProcessId &pid) {
+  ProcessSpawner ps;
+  StringCollection args;
+
+  ps.setExecutable(Platform::GetSelfExecutablePath());
+  args.push_back("slave");
+  if (GetLogLevel() == kLogLevelDebug) {
+    args.push_back("--debug");
+  } else if (GetLogLevel() == kLogLevelPacket) {
+    args.push_back("--remote-debug");
+  }
+  std::string const &outputFilename = GetLogOutputFilename();
+  if (outputFilename.length() > 0) {
+    args.push_back("--log-file");
+    args.push_back(outputFilename);
+  }
+#if defined(OS_POSIX)
+  args.push_back("--setsid");
+#endif
+  ps.setArguments(args);
+  ps.redirectInputToNull();
+  ps.redirectOutputToBuffer();
+
+  ErrorCode error;
+  error = ps.run();
+  if (error != kSuccess)
+    return error;
+  error = ps.wait();
+  if (error != kSuccess)
+    return error;
+
+  if (ps.exitStatus() != 0)
+    return kErrorInvalidArgument;
+
+  std::istringstream ss;
+  ss.str(ps.output());
+  ss >> port >> pid;
+
+  return kSuccess;
+}
+} // namespace GDBRemote
+} // namespace ds2
@@ -18,8 +18,14 @@
 #include "DebugServer2/Utils/HexValues.h"
 #include "DebugServer2/Utils/Log.h"
 #include "DebugServer2/Utils/Paths.h"
+#include "DebugServer2/Utils/ScopedJanitor.h"
+#include "DebugServer2/Utils/String.h"
 #include "DebugServer2/Utils/Stringify.h"
 
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
 #include <iomanip>
 #include <sstream>
 
@@ -32,27 +38,42 @@ namespace GDBRemote {
 
 DebugSessionImplBase::DebugSessionImplBase(StringCollection const &args,
                                            EnvironmentBlock const &env)
-    : DummySessionDelegateImpl(), _resumeSession(nullptr) {
+    : DummySessionDelegateImpl(), _nextCheckpoint(1), _reportedEvents(0),
+      _detachOnFork(true), _persistent(false), _resumeSession(nullptr),
+      _runningSession(nullptr) {
   DS2ASSERT(args.size() >= 1);
   _resumeSessionLock.lock();
   spawnProcess(args, env);
 }
 
 DebugSessionImplBase::DebugSessionImplBase(int attachPid)
-    : DummySessionDelegateImpl(), _resumeSession(nullptr) {
+    : DummySessionDelegateImpl(), _nextCheckpoint(1), _reportedEvents(0),
+      _detachOnFork(true), _persistent(false), _resumeSession(nullptr),
+      _runningSession(nullptr) {
   _resumeSessionLock.lock();
-  _process = ds2::Target::Process::Attach(attachPid);
+  setProcess(ds2::Target::Process::Attach(attachPid));
   if (_process == nullptr)
     DS2LOG(Fatal, "cannot attach to pid %d", attachPid);
 }
 
 DebugSessionImplBase::DebugSessionImplBase()
-    : DummySessionDelegateImpl(), _process(nullptr), _resumeSession(nullptr) {
+    : DummySessionDelegateImpl(), _process(nullptr), _nextCheckpoint(1),
+      _reportedEvents(0), _detachOnFork(true), _persistent(false),
+      _resumeSession(nullptr), _runningSession(nullptr) {
   _resumeSessionLock.lock();
 }
 
 DebugSessionImplBase::~DebugSessionImplBase() {
+#if defined(OS_LINUX)
+  stopProfiler();
+#endif
   _resumeSessionLock.unlock();
+  while (!_checkpoints.empty()) {
+    deleteCheckpoint(_checkpoints.begin()->first);
+  }
+  for (auto const &inferior : _inferiors) {
+    delete inferior.second;
+  }
   delete _process;
 }
 
@@ -68,18 +89,91 @@ size_t DebugSessionImplBase::getGPRSize() const {
 }
 
 ErrorCode DebugSessionImplBase::onInterrupt(Session &) {
+  if (cancelAttachWait())
+    return kSuccess;
+
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  return _process->interrupt();
+}
+
+ErrorCode DebugSessionImplBase::onDisconnect(Session &session) {
+  cancelAttachWait();
+
+  if (!_persistent)
+    return kSuccess;
+
+  //
+  // The main thread waits in onResume for as long as the process runs; stop
+  // the process so that it gets back to waiting for the next debugger.
+  //
+  if (_runningSession != &session)
+    return kSuccess;
+
+  DS2LOG(Info, "debugger disconnected, stopping the process");
   return _process->interrupt();
 }
 
+bool DebugSessionImplBase::prepareReconnect() {
+  if (_process == nullptr || !_process->isAlive())
+    return false;
+
+  // The next debugger inserts the breakpoints it wants.
+  std::vector<Target::Process *> processes = {_process};
+  for (auto const &inferior : _inferiors) {
+    processes.push_back(inferior.second);
+  }
+  // Neither does it get dirty page tracking or stack sampling it didn't ask
+  // for, which cost the process on every stop.
+  for (auto process : processes) {
+    if (process->softwareBreakpointManager() != nullptr) {
+      process->softwareBreakpointManager()->clear();
+    }
+    if (process->hardwareBreakpointManager() != nullptr) {
+      process->hardwareBreakpointManager()->clear();
+    }
+    process->enableDirtyPageTracking(false);
+  }
+
+  _programmedSignals.clear();
+  _savedRegisters.clear();
+  _expeditedRegisters.clear();
+  _consoleBuffer.clear();
+#if defined(OS_LINUX)
+  stopProfiler();
+  _stackSampler.reset();
+  _foldedStackSamples.clear();
+#endif
+
+  DS2LOG(Info, "keeping pid %" PRIu64 " for the next debugger",
+         (uint64_t)_process->pid());
+  return true;
+}
+
 ErrorCode DebugSessionImplBase::onQuerySupported(
     Session &session, Feature::Collection const &remoteFeatures,
     Feature::Collection &localFeatures) const {
+  _reportedEvents = 0;
   for (auto feature : remoteFeatures) {
     DS2LOG(Debug, "gdb feature: %s", feature.name.c_str());
+#if defined(OS_LINUX)
+    if (feature.flag != Feature::kSupported)
+      continue;
+    if (feature.name == "fork-events") {
+      _reportedEvents |= Target::Process::kReportFork;
+    } else if (feature.name == "vfork-events") {
+      _reportedEvents |= Target::Process::kReportVFork;
+    } else if (feature.name == "exec-events") {
+      _reportedEvents |= Target::Process::kReportExec;
+    }
+#endif
   }
 
   // TODO PacketSize should be respected
-  localFeatures.push_back(std::string("PacketSize=3fff"));
+  std::ostringstream packetSize;
+  packetSize << "PacketSize=" << std::hex << kMaxPacketSize;
+  localFeatures.push_back(packetSize.str());
   localFeatures.push_back(std::string("QStartNoAckMode+"));
   localFeatures.push_back(std::string("qXfer:features:read+"));
 #if defined(OS_LINUX) || defined(OS_FREEBSD)
@@ -90,6 +184,20 @@ ErrorCode DebugSessionImplBase::onQuerySupported(
 #endif
   localFeatures.push_back(std::string("QListThreadsInStopReply+"));
   localFeatures.push_back(std::string("QPassSignals+"));
+#if defined(OS_LINUX)
+  if (_reportedEvents & Target::Process::kReportFork) {
+    localFeatures.push_back(std::string("fork-events+"));
+  }
+  if (_reportedEvents & Target::Process::kReportVFork) {
+    localFeatures.push_back(std::string("vfork-events+"));
+  }
+  if (_reportedEvents & Target::Process::kReportExec) {
+    localFeatures.push_back(std::string("exec-events+"));
+  }
+  localFeatures.push_back(std::string("qSaveCore+"));
+  localFeatures.push_back(std::string("qDirtyMemoryRanges+"));
+  localFeatures.push_back(std::string("qXfer:stack-samples:read+"));
+#endif
 
   if (session.mode() != kCompatibilityModeLLDB) {
     localFeatures.push_back(std::string("ConditionalBreakpoints-"));
@@ -148,6 +256,12 @@ DebugSessionImplBase::onProgramSignals(Session &session,
 #endif
 }
 
+ErrorCode DebugSessionImplBase::onSetExpeditedRegisters(
+    Session &, std::vector<uint32_t> const &regnos) {
+  _expeditedRegisters = regnos;
+  return kSuccess;
+}
+
 ErrorCode DebugSessionImplBase::onNonStopMode(Session &session, bool enable) {
   if (enable)
     return kErrorUnsupported; // TODO support non-stop mode
@@ -155,25 +269,230 @@ ErrorCode DebugSessionImplBase::onNonStopMode(Session &session, bool enable) {
   return kSuccess;
 }
 
-Thread *DebugSessionImplBase::findThread(ProcessThreadId const &ptid) const {
+Target::Process *
+DebugSessionImplBase::findProcess(ProcessThreadId const &ptid) const {
   if (_process == nullptr)
     return nullptr;
 
-  if (ptid.validPid() && ptid.pid != _process->pid())
+  if (!ptid.validPid() || ptid.pid == _process->pid() ||
+      (_restoredPtid.validPid() && ptid.pid == _restoredPtid.pid))
+    return _process;
+
+  auto it = _inferiors.find(ptid.pid);
+  if (it == _inferiors.end())
+    return nullptr;
+
+  return it->second;
+}
+
+Thread *DebugSessionImplBase::findThread(ProcessThreadId const &ptid) const {
+  Target::Process *process = findProcess(ptid);
+  if (process == nullptr)
     return nullptr;
 
   Thread *thread = nullptr;
-  if (!ptid.validTid()) {
-    thread = _process->currentThread();
+  if (!ptid.validTid() ||
+      (process == _process && _restoredPtid.validTid() &&
+       ptid.tid == _restoredPtid.tid)) {
+    thread = process->currentThread();
   } else {
-    thread = _process->thread(ptid.tid);
+    thread = process->thread(ptid.tid);
   }
 
   return thread;
 }
 
+// Replaces the current process; what we remember about its last stop does
+// not apply to the new one.
+void DebugSessionImplBase::setProcess(Target::Process *process) {
+  _process = process;
+  _restoredPtid = ProcessThreadId();
+  _threadPCs.clear();
+  _threadsStopInfo.clear();
+}
+
+// Makes `process` the one that gets resumed and queried by default.
+void DebugSessionImplBase::switchProcess(Target::Process *process) {
+  if (process == _process)
+    return;
+
+  DS2LOG(Debug, "switching to pid %" PRIu64, (uint64_t)process->pid());
+  _inferiors.erase(process->pid());
+  _inferiors[_process->pid()] = _process;
+  setProcess(process);
+}
+
+// Forgets about a process we don't trace anymore. If it was the current one,
+// another inferior takes its place, if there is any left.
+void DebugSessionImplBase::releaseProcess(Target::Process *process) {
+  if (process == _process) {
+    if (_inferiors.empty()) {
+      // The process is kept around, but its last stop is not current anymore.
+      _threadPCs.clear();
+      _threadsStopInfo.clear();
+      return;
+    }
+    switchProcess(_inferiors.begin()->second);
+  }
+
+  _inferiors.erase(process->pid());
+  delete process;
+}
+
+//
+// Monitor commands: checkpoint, restart <n>, delete checkpoint <n> and info
+// checkpoints work like their GDB counterparts, except the copies of the
+// process are made on the target.
+//
+ErrorCode DebugSessionImplBase::onExecuteCommand(Session &session,
+                                                 std::string const &command) {
+  std::istringstream ss(command);
+  std::string verb, object;
+  int id;
+
+  ss >> verb;
+  if (verb == "checkpoint") {
+    return createCheckpoint(session);
+  } else if (verb == "restart") {
+    if (!(ss >> id))
+      return kErrorInvalidArgument;
+    return restoreCheckpoint(session, id);
+  } else if (verb == "delete" && (ss >> object) && object == "checkpoint") {
+    if (!(ss >> id))
+      return kErrorInvalidArgument;
+    return deleteCheckpoint(id);
+  } else if (verb == "info" && (ss >> object) && object == "checkpoints") {
+    std::ostringstream output;
+    for (auto const &checkpoint : _checkpoints) {
+      output << checkpoint.first << ": pid " << checkpoint.second->pid()
+             << '\n';
+    }
+    if (_checkpoints.empty()) {
+      output << "No checkpoints.\n";
+    }
+    session.send("O" + ToHex(output.str()));
+    return kSuccess;
+  }
+
+  return kErrorUnsupported;
+}
+
+ErrorCode DebugSessionImplBase::createCheckpoint(Session &session) {
+#if defined(OS_LINUX)
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  // Only the thread calling fork() is copied.
+  std::vector<ThreadId> tids;
+  _process->getThreadIds(tids);
+  if (tids.size() != 1)
+    return kErrorUnsupported;
+
+  Target::Process *snapshot;
+  CHK(_process->checkpoint(snapshot));
+
+  int id = _nextCheckpoint++;
+  _checkpoints[id] = snapshot;
+
+  std::ostringstream output;
+  output << "checkpoint " << id << ": fork returned pid " << snapshot->pid()
+         << '\n';
+  session.send("O" + ToHex(output.str()));
+  return kSuccess;
+#else
+  return kErrorUnsupported;
+#endif
+}
+
+//
+// The checkpoint itself is forked again so that it can be restarted more
+// than once; the copy replaces `_process`, which is killed.
+//
+// Checkpoints have a single thread, and so must `_process`: the debugger is
+// not told about the switch until the next stop reply, which is the only
+// packet that can carry the new ids, so meanwhile the ids it uses for the
+// old process and thread are taken to mean the copy's.
+//
+ErrorCode DebugSessionImplBase::restoreCheckpoint(Session &session, int id) {
+#if defined(OS_LINUX)
+  auto it = _checkpoints.find(id);
+  if (it == _checkpoints.end())
+    return kErrorNotFound;
+
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  std::vector<ThreadId> tids;
+  _process->getThreadIds(tids);
+  if (tids.size() != 1)
+    return kErrorUnsupported;
+
+  Target::Process *process;
+  CHK(it->second->checkpoint(process));
+
+  // The copy has the code of the process, but none of the breakpoints the
+  // debugger thinks are inserted.
+  BreakpointManager *bpm = _process->softwareBreakpointManager();
+  if (bpm != nullptr) {
+    bpm->enumerate([&](BreakpointManager::Site const &site) {
+      process->softwareBreakpointManager()->add(site.address, site.lifetime,
+                                                site.size, site.mode);
+    });
+  }
+  bpm = _process->hardwareBreakpointManager();
+  if (bpm != nullptr) {
+    bpm->enumerate([&](BreakpointManager::Site const &site) {
+      process->hardwareBreakpointManager()->add(site.address, site.lifetime,
+                                                site.size, site.mode);
+    });
+  }
+
+  // Keep the ids from before the first of several restores: the debugger
+  // hasn't seen the ones in between.
+  ProcessThreadId restoredPtid = _restoredPtid;
+  if (!restoredPtid.validPid()) {
+    restoredPtid = ProcessThreadId(_process->pid(), tids.front());
+  }
+
+  ProcessId oldPid = _process->pid();
+  if (_process->terminate() == kSuccess) {
+    _process->wait();
+  }
+  delete _process;
+  setProcess(process);
+  _restoredPtid = restoredPtid;
+
+  std::ostringstream output;
+  output << "switching from pid " << oldPid << " to pid " << process->pid()
+         << ", thread " << process->currentThread()->tid() << " (checkpoint "
+         << id << ")\n";
+  session.send("O" + ToHex(output.str()));
+  return kSuccess;
+#else
+  return kErrorUnsupported;
+#endif
+}
+
+ErrorCode DebugSessionImplBase::deleteCheckpoint(int id) {
+  auto it = _checkpoints.find(id);
+  if (it == _checkpoints.end())
+    return kErrorNotFound;
+
+  Target::Process *snapshot = it->second;
+  _checkpoints.erase(it);
+
+  // A parked copy must not outlive us, or it would start running as soon as
+  // nothing traces it anymore.
+  if (snapshot->terminate() == kSuccess) {
+    snapshot->wait();
+  }
+  delete snapshot;
+  return kSuccess;
+}
+
 ErrorCode DebugSessionImplBase::queryStopInfo(Session &session, Thread *thread,
-                                              StopInfo &stop) const {
+                                              StopInfo &stop,
+                                              bool listThreads) const {
   DS2ASSERT(thread != nullptr);
 
   // Directly copy the fields that are common between ds2::StopInfo and
@@ -201,6 +520,24 @@ ErrorCode DebugSessionImplBase::queryStopInfo(Session &session, Thread *thread,
     CHK(thread->readCPUState(state));
     state.getStopGPState(stop.registers,
                          session.mode() == kCompatibilityModeLLDB);
+    _threadPCs[stop.ptid.tid] = state.pc();
+
+    for (uint32_t regno : _expeditedRegisters) {
+      void *ptr;
+      size_t length;
+      bool success;
+
+      if (session.mode() == kCompatibilityModeLLDB) {
+        success = state.getLLDBRegisterPtr(regno, &ptr, &length);
+      } else {
+        success = state.getGDBRegisterPtr(regno, &ptr, &length);
+      }
+
+      if (success) {
+        stop.expeditedRegisters.push_back(std::make_pair(regno, length));
+        stop.expeditedData.append(static_cast<char *>(ptr), length);
+      }
+    }
   } break;
 
   case StopInfo::kEventExit:
@@ -212,12 +549,41 @@ ErrorCode DebugSessionImplBase::queryStopInfo(Session &session, Thread *thread,
     DS2BUG("impossible StopInfo event: %s", Stringify::StopEvent(stop.event));
   }
 
-  _process->enumerateThreads(
-      [&](Thread *thread) { stop.threads.insert(thread->tid()); });
+  if (!listThreads)
+    return kSuccess;
+
+  thread->process()->enumerateThreads(
+      [&](Thread *thread) { stop.threads.push_back(thread->tid()); });
+
+  if (stop.event == StopInfo::kEventStop &&
+      session.mode() == kCompatibilityModeLLDB &&
+      session.threadsInStopReply()) {
+    queryThreadPCs(thread->process(), stop);
+  }
 
   return kSuccess;
 }
 
+// Only the general purpose registers of each thread are read, once per stop.
+void DebugSessionImplBase::queryThreadPCs(Target::Process *process,
+                                          StopInfo &stop) const {
+  stop.threadPCs.reserve(stop.threads.size());
+  for (auto tid : stop.threads) {
+    auto it = _threadPCs.find(tid);
+    if (it == _threadPCs.end()) {
+      Thread *thread = process->thread(tid);
+      Architecture::CPUState state;
+      if (thread == nullptr || thread->readGPRState(state) != kSuccess) {
+        // thread-pcs is all or nothing.
+        stop.threadPCs.clear();
+        return;
+      }
+      it = _threadPCs.insert(std::make_pair(tid, state.pc())).first;
+    }
+    stop.threadPCs.push_back(it->second);
+  }
+}
+
 ErrorCode DebugSessionImplBase::queryStopInfo(Session &session,
                                               ProcessThreadId const &ptid,
                                               StopInfo &stop) const {
@@ -238,26 +604,13 @@ ErrorCode DebugSessionImplBase::onQueryThreadStopInfo(
   return queryStopInfo(session, ptid, stop);
 }
 
-ErrorCode DebugSessionImplBase::onQueryThreadList(Session &, ProcessId pid,
-                                                  ThreadId lastTid,
-                                                  ThreadId &tid) const {
+ErrorCode DebugSessionImplBase::onQueryThreadList(
+    Session &, ProcessId pid, ThreadId lastTid, size_t count,
+    std::vector<ThreadId> &tids) const {
   if (_process == nullptr)
     return kErrorProcessNotFound;
 
-  std::vector<ThreadId> tids;
-
-  if (lastTid == kAllThreadId) {
-    _process->getThreadIds(tids);
-    _threadIterationState.vals = tids;
-    _threadIterationState.it = _threadIterationState.vals.begin();
-  } else if (lastTid != kAnyThreadId) {
-    return kErrorInvalidArgument;
-  }
-
-  if (_threadIterationState.it == _threadIterationState.vals.end())
-    return kErrorNotFound;
-
-  tid = *_threadIterationState.it++;
+  _process->getThreadIds(lastTid, count, tids);
   return kSuccess;
 }
 
@@ -276,8 +629,9 @@ DebugSessionImplBase::onQueryCurrentThread(Session &,
   return kSuccess;
 }
 
-ErrorCode DebugSessionImplBase::onThreadIsAlive(Session &session,
-                                                ProcessThreadId const &ptid) {
+ErrorCode
+DebugSessionImplBase::onThreadIsAlive(Session &session,
+                                      ProcessThreadId const &ptid) const {
   if (_process == nullptr)
     return kErrorProcessNotFound;
 
@@ -291,6 +645,19 @@ ErrorCode DebugSessionImplBase::onThreadIsAlive(Session &session,
   return kSuccess;
 }
 
+ErrorCode DebugSessionImplBase::onSelectThread(Session &session,
+                                               ProcessThreadId const &ptid) {
+  CHK(onThreadIsAlive(session, ptid));
+
+  // Selecting a thread of another inferior makes it the current one.
+  Thread *thread = findThread(ptid);
+  if (thread != nullptr) {
+    switchProcess(thread->process());
+  }
+
+  return kSuccess;
+}
+
 ErrorCode DebugSessionImplBase::onQueryAttached(Session &, ProcessId pid,
                                                 bool &attachedProcess) const {
   if (_process == nullptr)
@@ -307,7 +674,7 @@ ErrorCode DebugSessionImplBase::onQueryProcessInfo(Session &,
   if (_process == nullptr)
     return kErrorProcessNotFound;
   else
-    return _process->getInfo(info);
+    return _process->getCurrentInfo(info);
 }
 
 ErrorCode
@@ -457,6 +824,33 @@ ErrorCode DebugSessionImplBase::onQuerySharedLibrariesInfoAddress(
 #endif
 }
 
+ErrorCode DebugSessionImplBase::onSaveCore(Session &,
+                                           std::string const &pathHint,
+                                           std::string &path) {
+  if (_process == nullptr) {
+    return kErrorProcessNotFound;
+  }
+
+  // The debugger's choice is used as is; the default location is shared
+  // with other users, so the file gets a name of its own there.
+  path = pathHint;
+  bool unique = path.empty();
+  if (unique) {
+    char const *tmpdir = ::getenv("TMPDIR");
+#if defined(PLATFORM_ANDROID)
+    std::string dir = (tmpdir != nullptr) ? tmpdir : "/data/local/tmp";
+#else
+    std::string dir = (tmpdir != nullptr) ? tmpdir : "/tmp";
+#endif
+    path = dir + "/core." + ds2::Utils::ToString(_process->pid()) + ".XXXXXX";
+  }
+
+  CHK(_process->saveCore(path, unique));
+  DS2LOG(Info, "wrote core file of pid %" PRI_PID " to %s", _process->pid(),
+         path.c_str());
+  return kSuccess;
+}
+
 ErrorCode DebugSessionImplBase::onQueryFileLoadAddress(
     Session &session, std::string const &file_path, Address &address) {
   if (_process == nullptr) {
@@ -591,6 +985,22 @@ ErrorCode DebugSessionImplBase::onXferRead(Session &session,
     ss << sslibs.str();
     ss << "</library-list-svr4>";
     buffer = ss.str().substr(offset);
+#if defined(OS_LINUX)
+  } else if (object == "stack-samples") {
+    // Folding is costly and sees new samples every time, so it is only done
+    // for the first chunk; later ones must come from the same text.
+    if (offset == 0) {
+      _foldedStackSamples.clear();
+      CHK(foldStackSamples(_foldedStackSamples));
+    } else if (offset > _foldedStackSamples.length()) {
+      return kErrorInvalidArgument;
+    }
+
+    buffer = _foldedStackSamples.substr(offset);
+    if (buffer.length() <= length) {
+      _foldedStackSamples.clear();
+    }
+#endif
   } else {
     return kErrorUnsupported;
   }
@@ -660,6 +1070,8 @@ ErrorCode DebugSessionImplBase::onWriteGeneralRegisters(
 
   state.setGPState(regs);
 
+  _threadPCs.erase(thread->tid());
+  _threadsStopInfo.clear();
   return thread->writeCPUState(state);
 }
 
@@ -693,6 +1105,8 @@ ErrorCode DebugSessionImplBase::onRestoreRegisters(Session &session,
 
   CHK(thread->writeCPUState(it->second));
 
+  _threadPCs.erase(thread->tid());
+  _threadsStopInfo.clear();
   _savedRegisters.erase(it);
 
   return kSuccess;
@@ -756,6 +1170,8 @@ ErrorCode DebugSessionImplBase::onWriteRegisterValue(
 
   std::memcpy(ptr, value.c_str(), length);
 
+  _threadPCs.erase(thread->tid());
+  _threadsStopInfo.clear();
   return thread->writeCPUState(state);
 }
 
@@ -809,6 +1225,93 @@ DebugSessionImplBase::onQueryMemoryRegionInfo(Session &, Address const &address,
     return _process->getMemoryRegionInfo(address, info);
 }
 
+ErrorCode DebugSessionImplBase::onEnableDirtyPageTracking(Session &,
+                                                          bool enable) {
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  return _process->enableDirtyPageTracking(enable);
+}
+
+ErrorCode DebugSessionImplBase::onQueryDirtyMemoryRanges(
+    Session &, MemoryRange::Collection &ranges) const {
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  return _process->getDirtyMemoryRanges(ranges);
+}
+
+ErrorCode DebugSessionImplBase::onSymbolicateAddresses(
+    Session &, std::vector<uint64_t> const &addresses,
+    SymbolInfo::Collection &symbols) {
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  return _process->symbolicate(addresses, symbols);
+}
+
+ErrorCode DebugSessionImplBase::onEnableAsynchronousProfiling(
+    Session &, ProcessThreadId const &, bool enabled, uint32_t interval,
+    uint32_t scanType) {
+#if defined(OS_LINUX)
+  stopProfiler();
+  if (!enabled)
+    return kSuccess;
+
+  _profilerEnabled = true;
+  _profilerInterval = interval;
+  _profilerScanType = scanType;
+  _profilerThread = std::thread(&DebugSessionImplBase::profilerThread, this);
+  return kSuccess;
+#else
+  return kErrorUnsupported;
+#endif
+}
+
+ErrorCode DebugSessionImplBase::onQueryProfileData(Session &,
+                                                   ProcessThreadId const &,
+                                                   uint32_t,
+                                                   ProfileData &data) {
+#if defined(OS_LINUX)
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  std::lock_guard<std::mutex> guard(_profilerLock);
+  if (!_profileSampler || _profileSampler->pid() != _process->pid()) {
+    _profileSampler =
+        ds2::make_unique<Host::Linux::ProfileSampler>(_process->pid());
+  }
+  return _profileSampler->sample(data);
+#else
+  return kErrorUnsupported;
+#endif
+}
+
+ErrorCode DebugSessionImplBase::onEnableStackSampling(Session &,
+                                                      uint32_t frequency) {
+#if defined(OS_LINUX)
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  // Stopping keeps the samples around so that they can still be read.
+  if (frequency == 0) {
+    if (_stackSampler) {
+      _stackSampler->stop();
+    }
+    return kSuccess;
+  }
+
+  _stackSampler.reset();
+  auto sampler =
+      ds2::make_unique<Host::Linux::StackSampler>(_process->pid(), frequency);
+  CHK(sampler->start());
+  _stackSampler = std::move(sampler);
+  return kSuccess;
+#else
+  return kErrorUnsupported;
+#endif
+}
+
 ErrorCode
 DebugSessionImplBase::onSetProgramArguments(Session &,
                                             StringCollection const &args) {
@@ -833,7 +1336,7 @@ ErrorCode DebugSessionImplBase::onAttach(Session &session, ProcessId pid,
     return kErrorInvalidArgument;
 
   DS2LOG(Debug, "attaching to pid %" PRIu64, (uint64_t)pid);
-  _process = Target::Process::Attach(pid);
+  setProcess(Target::Process::Attach(pid));
   if (_process == nullptr) {
     return kErrorProcessNotFound;
   }
@@ -841,6 +1344,93 @@ ErrorCode DebugSessionImplBase::onAttach(Session &session, ProcessId pid,
   return queryStopInfo(session, pid, stop);
 }
 
+ErrorCode DebugSessionImplBase::onAttach(Session &session,
+                                         std::string const &name,
+                                         AttachMode mode, StopInfo &stop) {
+  if (_process != nullptr)
+    return kErrorAlreadyExist;
+
+  ProcessInfoMatch match;
+  match.name = name;
+  match.keys.push_back("name");
+
+  auto matches = [&](ProcessId pid, std::string const &path) {
+    return pid != Platform::GetCurrentProcessId() && match.matchesName(path);
+  };
+
+#if defined(OS_LINUX)
+  // Start watching before looking at the running processes, otherwise we
+  // could miss one that execs in between.
+  auto janitor = Utils::MakeJanitor([this]() {
+    std::lock_guard<std::mutex> guard(_execWatcherLock);
+    _execWatcher.reset();
+  });
+  if (mode != kAttachNow) {
+    {
+      std::lock_guard<std::mutex> guard(_execWatcherLock);
+      _execWatcher = ds2::make_unique<Host::Linux::ExecWatcher>();
+    }
+    CHK(_execWatcher->start());
+  }
+#endif
+
+  ProcessId pid = kAnyProcessId;
+  bool stopped = false;
+  if (mode != kAttachAndWait) {
+    Platform::EnumerateProcesses(true, UserId(), matches,
+                                 [&](ds2::ProcessInfo const &info) {
+                                   if (pid == kAnyProcessId) {
+                                     pid = info.pid;
+                                   }
+                                 });
+  }
+
+  if (pid == kAnyProcessId) {
+    if (mode == kAttachNow)
+      return kErrorProcessNotFound;
+
+#if defined(OS_LINUX)
+    DS2LOG(Debug, "waiting for a process named '%s'", name.c_str());
+    pid_t waitPid;
+    CHK(_execWatcher->wait(matches, waitPid));
+    pid = waitPid;
+
+    // PTRACE_ATTACH only stops the process once its SIGSTOP is delivered,
+    // stop it now so that it doesn't run further than it already has.
+    // Process::attach copes with the process being stopped already.
+    if (::kill(pid, SIGSTOP) < 0) {
+      return kErrorProcessNotFound;
+    }
+    stopped = true;
+#else
+    return kErrorUnsupported;
+#endif
+  }
+
+  ErrorCode error = onAttach(session, pid, kAttachNow, stop);
+#if defined(OS_LINUX)
+  if (error != kSuccess && stopped) {
+    // Don't leave it stopped behind us.
+    ::kill(pid, SIGCONT);
+  }
+#endif
+  return error;
+}
+
+//
+// Returns true if we were waiting for a process to attach to.
+//
+bool DebugSessionImplBase::cancelAttachWait() {
+#if defined(OS_LINUX)
+  std::lock_guard<std::mutex> guard(_execWatcherLock);
+  if (_execWatcher) {
+    _execWatcher->cancel();
+    return true;
+  }
+#endif
+  return false;
+}
+
 ErrorCode
 DebugSessionImplBase::onResume(Session &session,
                                ThreadResumeAction::Collection const &actions,
@@ -852,8 +1442,25 @@ DebugSessionImplBase::onResume(Session &session,
 
   DS2ASSERT(_resumeSession == nullptr);
   _resumeSession = &session;
+#if defined(OS_LINUX)
+  _profiledPid = _process->pid();
+#endif
+  _runningSession = &session;
   _resumeSessionLock.unlock();
 
+#if defined(OS_LINUX)
+  // LLDB doesn't negotiate exec events, but expects them like lldb-server
+  // reports them: it has to re-resolve its breakpoints in the new image.
+  uint32_t reportedEvents = _reportedEvents;
+  if (session.mode() == kCompatibilityModeLLDB) {
+    reportedEvents |= Target::Process::kReportExec;
+  }
+  _process->setReportedEvents(reportedEvents);
+  _process->setDetachOnFork(_detachOnFork);
+#endif
+
+  _threadPCs.clear();
+  _threadsStopInfo.clear();
   error = _process->beforeResume();
   if (error != kSuccess)
     goto ret;
@@ -990,30 +1597,52 @@ DebugSessionImplBase::onResume(Session &session,
     goto ret;
   }
 
+#if defined(OS_LINUX)
+  for (;;) {
+    Target::Process *child = _process->adoptForkedChild();
+    if (child == nullptr)
+      break;
+    DS2LOG(Debug, "now tracing forked child %" PRIu64, (uint64_t)child->pid());
+    _inferiors[child->pid()] = child;
+  }
+#endif
+
   error = queryStopInfo(session, _process->currentThread(), stop);
 
   if (stop.event == StopInfo::kEventExit ||
       stop.event == StopInfo::kEventKill) {
-    _spawner.flushAndExit();
+    if (_inferiors.empty()) {
+      _spawner.flushAndExit();
+    } else {
+      releaseProcess(_process);
+    }
   }
 
 ret:
+  _runningSession = nullptr;
   _resumeSessionLock.lock();
   _resumeSession = nullptr;
   return error;
 }
 
-ErrorCode DebugSessionImplBase::onDetach(Session &, ProcessId, bool stopped) {
-  SoftwareBreakpointManager *bpm = _process->softwareBreakpointManager();
+ErrorCode DebugSessionImplBase::onDetach(Session &, ProcessId pid,
+                                         bool stopped) {
+  Target::Process *process = findProcess(pid);
+  if (process == nullptr)
+    return kErrorProcessNotFound;
+
+  SoftwareBreakpointManager *bpm = process->softwareBreakpointManager();
   if (bpm != nullptr) {
     bpm->clear();
   }
 
   if (stopped) {
-    CHK(_process->suspend());
+    CHK(process->suspend());
   }
 
-  return _process->detach();
+  CHK(process->detach());
+  releaseProcess(process);
+  return kSuccess;
 }
 
 ErrorCode DebugSessionImplBase::onTerminate(Session &session,
@@ -1021,19 +1650,25 @@ ErrorCode DebugSessionImplBase::onTerminate(Session &session,
                                             StopInfo &stop) {
   ErrorCode error;
 
-  error = _process->terminate();
+  Target::Process *process = findProcess(ptid);
+  if (process == nullptr)
+    return kErrorProcessNotFound;
+
+  error = process->terminate();
   if (error != kSuccess) {
     DS2LOG(Error, "couldn't terminate process");
     return error;
   }
 
-  error = _process->wait();
+  error = process->wait();
   if (error != kSuccess) {
     DS2LOG(Error, "couldn't wait for process termination");
     return error;
   }
 
-  return queryStopInfo(session, _process->currentThread(), stop);
+  CHK(queryStopInfo(session, process->currentThread(), stop));
+  releaseProcess(process);
+  return kSuccess;
 }
 
 ErrorCode DebugSessionImplBase::onExitServer(Session &session) {
@@ -1041,9 +1676,31 @@ ErrorCode DebugSessionImplBase::onExitServer(Session &session) {
   ProcessId pid = kAnyProcessId;
   StopInfo stop;
 
+  while (!_checkpoints.empty()) {
+    deleteCheckpoint(_checkpoints.begin()->first);
+  }
+
+  std::vector<ProcessId> pids;
+  for (auto const &inferior : _inferiors) {
+    pids.push_back(inferior.first);
+  }
+  for (ProcessId inferiorPid : pids) {
+    Target::Process *process = _inferiors[inferiorPid];
+    ErrorCode inferiorError = process->attached()
+                                  ? onDetach(session, inferiorPid, false)
+                                  : onTerminate(session, inferiorPid, stop);
+    if (inferiorError != kSuccess) {
+      error = inferiorError;
+    }
+  }
+
   if (_process != nullptr) {
-    error = _process->attached() ? onDetach(session, pid, false)
+    ErrorCode processError = _process->attached()
+                                 ? onDetach(session, pid, false)
                                  : onTerminate(session, pid, stop);
+    if (processError != kSuccess) {
+      error = processError;
+    }
   }
 
   DS2LOG(Debug, "exiting ds2");
@@ -1155,7 +1812,7 @@ ErrorCode DebugSessionImplBase::spawnProcess(StringCollection const &args,
   _spawner.redirectOutputToDelegate(outputDelegate);
   _spawner.redirectErrorToDelegate(outputDelegate);
 
-  _process = ds2::Target::Process::Create(_spawner);
+  setProcess(ds2::Target::Process::Create(_spawner));
   if (_process == nullptr) {
     DS2LOG(Error, "cannot execute '%s'", args[0].c_str());
     return kErrorUnknown;
@@ -1165,20 +1822,172 @@ ErrorCode DebugSessionImplBase::spawnProcess(StringCollection const &args,
 }
 
 void DebugSessionImplBase::appendOutput(char const *buf, size_t size) {
-  for (size_t i = 0; i < size; ++i) {
-    this->_consoleBuffer += buf[i];
-    if (buf[i] == '\n') {
-      _resumeSessionLock.lock();
-      DS2ASSERT(_resumeSession != nullptr);
-      std::string data = "O";
-      data += ToHex(this->_consoleBuffer);
-      _consoleBuffer.clear();
-      this->_resumeSession->send(data);
+  // Maximum number of raw console bytes sent in a single `O` packet. Once
+  // hex-encoded this stays well under the packet size we advertise, and it
+  // bounds how long the main thread can wait on `_resumeSessionLock` while we
+  // are sending.
+  static size_t const kMaxConsoleChunk = 4096;
+
+  _consoleBuffer.append(buf, size);
+
+  // Only forward complete lines, unless a single line grows larger than what
+  // fits in a packet; in that case, forward what we have so that the amount
+  // of buffered output stays bounded.
+  size_t flushSize = _consoleBuffer.rfind('\n');
+  flushSize = (flushSize == std::string::npos) ? 0 : flushSize + 1;
+  if (_consoleBuffer.size() >= kMaxConsoleChunk) {
+    flushSize = _consoleBuffer.size();
+  }
+
+  for (size_t offset = 0; offset < flushSize; offset += kMaxConsoleChunk) {
+    size_t chunkSize = std::min(kMaxConsoleChunk, flushSize - offset);
+
+    std::string data;
+    data.reserve(1 + 2 * chunkSize);
+    data += 'O';
+    for (size_t n = offset; n < offset + chunkSize; n++) {
+      data += NibbleToHex(_consoleBuffer[n] >> 4);
+      data += NibbleToHex(_consoleBuffer[n] & 0x0f);
+    }
+
+    // Only hold the lock while sending, so that the main thread can reclaim it
+    // between two packets.
+    _resumeSessionLock.lock();
+    DS2ASSERT(_resumeSession != nullptr);
+    _resumeSession->send(data);
+    _resumeSessionLock.unlock();
+  }
+
+  _consoleBuffer.erase(0, flushSize);
+}
+
+#if defined(OS_LINUX)
+void DebugSessionImplBase::profilerThread() {
+  std::unique_lock<std::mutex> lock(_profilerLock);
+  std::chrono::microseconds interval(_profilerInterval);
+
+  for (;;) {
+    if (_profilerCond.wait_for(lock, interval,
+                               [this] { return !_profilerEnabled; }))
+      return;
+
+    //
+    // The main thread holds `_resumeSessionLock` whenever the process isn't
+    // running; never block on it, so that samples are simply skipped while
+    // the process is stopped.
+    //
+    ProcessId pid = kAnyProcessId;
+    if (_resumeSessionLock.try_lock()) {
+      if (_resumeSession != nullptr) {
+        pid = _profiledPid;
+      }
+      _resumeSessionLock.unlock();
+    }
+    if (pid == kAnyProcessId)
+      continue;
+
+    if (!_profileSampler || _profileSampler->pid() != pid) {
+      _profileSampler = ds2::make_unique<Host::Linux::ProfileSampler>(pid);
+    }
+
+    ProfileData data;
+    if (_profileSampler->sample(data) != kSuccess)
+      continue;
+
+    std::string packet = "A" + data.encode(_profilerScanType);
+    if (_resumeSessionLock.try_lock()) {
+      if (_resumeSession != nullptr) {
+        _resumeSession->send(packet);
+      }
       _resumeSessionLock.unlock();
     }
   }
 }
 
+ErrorCode DebugSessionImplBase::foldStackSamples(std::string &folded) {
+  if (!_stackSampler)
+    return kErrorInvalidArgument;
+
+  Host::Linux::StackSampler::StackCounts stacks;
+  uint64_t lost;
+  _stackSampler->getStacks(stacks, lost);
+  DS2LOG(Debug, "%zu distinct stacks, %" PRIu64 " samples lost", stacks.size(),
+         lost);
+
+  //
+  // Return addresses point after the call, which might be in the next
+  // symbol; look up the call instead. Only the innermost frame is a PC.
+  //
+  auto lookupAddress = [](Host::Linux::StackSampler::Stack const &stack,
+                          size_t n) {
+    return (n + 1 == stack.size()) ? stack[n] : stack[n] - 1;
+  };
+
+  std::vector<uint64_t> addresses;
+  for (auto const &stack : stacks) {
+    for (size_t n = 0; n < stack.first.size(); n++) {
+      addresses.push_back(lookupAddress(stack.first, n));
+    }
+  }
+  std::sort(addresses.begin(), addresses.end());
+  addresses.erase(std::unique(addresses.begin(), addresses.end()),
+                  addresses.end());
+
+  SymbolInfo::Collection symbols;
+  CHK(_process->symbolicate(addresses, symbols));
+
+  std::vector<std::string> names;
+  names.reserve(addresses.size());
+  for (size_t n = 0; n < addresses.size(); n++) {
+    std::ostringstream ss;
+    if (!symbols[n].name.empty()) {
+      ss << symbols[n].name;
+    } else if (!symbols[n].module.empty()) {
+      ss << ds2::Utils::Basename(symbols[n].module) << "+0x" << std::hex
+         << symbols[n].offset;
+    } else {
+      ss << "0x" << std::hex << addresses[n];
+    }
+    names.push_back(ss.str());
+  }
+
+  // Stacks that only differ by addresses within the same symbols are merged.
+  std::map<std::string, uint64_t> foldedStacks;
+  for (auto const &stack : stacks) {
+    std::string frames;
+    for (size_t n = 0; n < stack.first.size(); n++) {
+      auto it = std::lower_bound(addresses.begin(), addresses.end(),
+                                 lookupAddress(stack.first, n));
+      if (n != 0) {
+        frames += ';';
+      }
+      frames += names[it - addresses.begin()];
+    }
+    foldedStacks[frames] += stack.second;
+  }
+
+  std::ostringstream ss;
+  for (auto const &stack : foldedStacks) {
+    ss << stack.first << ' ' << stack.second << '\n';
+  }
+  folded = ss.str();
+
+  return kSuccess;
+}
+
+void DebugSessionImplBase::stopProfiler() {
+  if (!_profilerThread.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> guard(_profilerLock);
+    _profilerEnabled = false;
+  }
+  _profilerCond.notify_one();
+  _profilerThread.join();
+}
+#endif
+
 ErrorCode DebugSessionImplBase::onSendInput(Session &session,
                                             ByteVector const &buf) {
   return _spawner.input(buf);
@@ -1188,25 +1997,51 @@ ErrorCode DebugSessionImplBase::fetchStopInfoForAllThreads(
     Session &session, std::vector<StopInfo> &stops, StopInfo &processStop) {
   CHK(onQueryThreadStopInfo(session, ProcessThreadId(), processStop));
 
+  // Each thread's own list of threads would only be thrown away.
   for (auto const &tid : processStop.threads) {
+    Thread *thread = _process->thread(tid);
+    if (thread == nullptr)
+      continue;
+
     StopInfo stop;
-    onQueryThreadStopInfo(session, ProcessThreadId(kAnyProcessId, tid), stop);
+    queryStopInfo(session, thread, stop, false);
     stops.push_back(stop);
   }
 
   return kSuccess;
 }
 
+//
+// LLDB asks for the stop info of each thread after a stop, and each reply
+// carries this array: it is built once per stop, and only lists the threads
+// that stopped for a reason, as the others are of no interest to LLDB.
+//
 ErrorCode
 DebugSessionImplBase::createThreadsStopInfo(Session &session,
-                                            JSArray &threadsStopInfo) {
-  StopInfo processStop;
-  std::vector<StopInfo> stops;
-  CHK(fetchStopInfoForAllThreads(session, stops, processStop));
+                                            std::string &threadsStopInfo) {
+  if (_process == nullptr)
+    return kErrorProcessNotFound;
+
+  if (_threadsStopInfo.empty()) {
+    JSArray array;
+    ErrorCode error = _process->enumerateThreads([&](Thread *thread) {
+      auto const &info = thread->stopInfo();
+      if (info.event != StopInfo::kEventStop ||
+          info.reason == StopInfo::kReasonNone)
+        return;
 
-  for (auto const &stop : stops) {
-    threadsStopInfo.append(stop.encodeJson());
+      StopInfo stop;
+      if (queryStopInfo(session, thread, stop, false) == kSuccess) {
+        array.append(stop.encodeJson());
+      }
+    });
+    if (error != kSuccess)
+      return error;
+
+    _threadsStopInfo = array.toString();
   }
+
+  threadsStopInfo = _threadsStopInfo;
   return kSuccess;
 }
 } // namespace GDBRemote
@@ -124,6 +124,9 @@ DUMMY_IMPL_EMPTY(onPassSignals, Session &, std::vector<int> const &)
 
 DUMMY_IMPL_EMPTY(onProgramSignals, Session &, std::vector<int> const &)
 
+DUMMY_IMPL_EMPTY(onSetExpeditedRegisters, Session &,
+                 std::vector<uint32_t> const &)
+
 DUMMY_IMPL_EMPTY_CONST(onQuerySymbol, Session &, std::string const &,
                        std::string const &, std::string &)
 
@@ -150,14 +153,17 @@ DUMMY_IMPL_EMPTY_CONST(onQuerySectionOffsets, Session &, Address &, Address &,
 
 DUMMY_IMPL_EMPTY_CONST(onQuerySharedLibrariesInfoAddress, Session &, Address &)
 
-DUMMY_IMPL_EMPTY_CONST(onQuerySharedLibraryInfo, Session &,
-                       std::string const &path, std::string const &triple,
-                       SharedLibraryInfo &info)
+DUMMY_IMPL_EMPTY_CONST(onQueryModuleInfo, Session &, std::string const &,
+                       ModuleInfo &)
+
+DUMMY_IMPL_EMPTY(onSaveCore, Session &, std::string const &, std::string &)
 
 DUMMY_IMPL_EMPTY(onRestart, Session &, ProcessId)
 
 DUMMY_IMPL_EMPTY(onInterrupt, Session &)
 
+DUMMY_IMPL_EMPTY(onDisconnect, Session &)
+
 DUMMY_IMPL_EMPTY(onTerminate, Session &, ProcessThreadId const &, StopInfo &)
 
 DUMMY_IMPL_EMPTY(onExitServer, Session &)
@@ -165,14 +171,16 @@ DUMMY_IMPL_EMPTY(onExitServer, Session &)
 DUMMY_IMPL_EMPTY(onSynchronizeThreadState, Session &, ProcessId)
 
 DUMMY_IMPL_EMPTY_CONST(onQueryThreadList, Session &, ProcessId, ThreadId,
-                       ThreadId &)
+                       size_t, std::vector<ThreadId> &)
 
 DUMMY_IMPL_EMPTY_CONST(onQueryCurrentThread, Session &, ProcessThreadId &)
 
 DUMMY_IMPL_EMPTY_CONST(onQueryThreadStopInfo, Session &,
                        ProcessThreadId const &, StopInfo &)
 
-DUMMY_IMPL_EMPTY(onThreadIsAlive, Session &, ProcessThreadId const &)
+DUMMY_IMPL_EMPTY_CONST(onThreadIsAlive, Session &, ProcessThreadId const &)
+
+DUMMY_IMPL_EMPTY(onSelectThread, Session &, ProcessThreadId const &)
 
 DUMMY_IMPL_EMPTY_CONST(onQueryThreadInfo, Session &, ProcessThreadId const &,
                        uint32_t, void *)
@@ -186,8 +194,10 @@ DUMMY_IMPL_EMPTY_CONST(onQueryTIBAddress, Session &, ProcessThreadId const &,
 DUMMY_IMPL_EMPTY(onEnableAsynchronousProfiling, Session &,
                  ProcessThreadId const &, bool, uint32_t, uint32_t)
 
-DUMMY_IMPL_EMPTY_CONST(onQueryProfileData, Session &, ProcessThreadId const &,
-                       uint32_t, void *)
+DUMMY_IMPL_EMPTY(onQueryProfileData, Session &, ProcessThreadId const &,
+                 uint32_t, ProfileData &)
+
+DUMMY_IMPL_EMPTY(onEnableStackSampling, Session &, uint32_t)
 
 DUMMY_IMPL_EMPTY(onResume, Session &, ThreadResumeAction::Collection const &,
                  StopInfo &)
@@ -222,6 +232,14 @@ DUMMY_IMPL_EMPTY(onDeallocateMemory, Session &, Address const &)
 DUMMY_IMPL_EMPTY_CONST(onQueryMemoryRegionInfo, Session &, Address const &,
                        MemoryRegionInfo &)
 
+DUMMY_IMPL_EMPTY(onEnableDirtyPageTracking, Session &, bool)
+
+DUMMY_IMPL_EMPTY_CONST(onQueryDirtyMemoryRanges, Session &,
+                       MemoryRange::Collection &)
+
+DUMMY_IMPL_EMPTY(onSymbolicateAddresses, Session &,
+                 std::vector<uint64_t> const &, SymbolInfo::Collection &)
+
 DUMMY_IMPL_EMPTY(onComputeCRC, Session &, Address const &, size_t, uint32_t &)
 
 DUMMY_IMPL_EMPTY(onSearchBackward, Session &, Address const &, uint32_t,
@@ -315,6 +333,7 @@ DUMMY_IMPL_EMPTY(onFlashDone, Session &)
 DUMMY_IMPL_EMPTY(fetchStopInfoForAllThreads, Session &,
                  std::vector<StopInfo> &stops, StopInfo &processStop)
 
-DUMMY_IMPL_EMPTY(createThreadsStopInfo, Session &, JSArray &threadsStopInfo)
+DUMMY_IMPL_EMPTY(createThreadsStopInfo, Session &,
+                 std::string &threadsStopInfo)
 } // namespace GDBRemote
 } // namespace ds2
@@ -12,6 +12,11 @@
 
 #include "DebugServer2/GDBRemote/Mixins/FileOperationsMixin.h"
 #include "DebugServer2/Host/Platform.h"
+#if defined(OS_LINUX) || defined(OS_FREEBSD)
+#include "DebugServer2/Support/POSIX/ELFModuleCache.h"
+#endif
+
+#include <cstring>
 
 namespace ds2 {
 namespace GDBRemote {
@@ -94,5 +99,30 @@ ErrorCode FileOperationsMixin<T>::onFileSetPermissions(Session &session,
                                                        uint32_t mode) {
   return Host::File::chmod(path, mode);
 }
+
+template <typename T>
+ErrorCode FileOperationsMixin<T>::onFileComputeMD5(Session &session,
+                                                   std::string const &path,
+                                                   uint8_t digest[16]) {
+#if defined(OS_LINUX) || defined(OS_FREEBSD)
+  ModuleInfo info;
+  CHK(Support::ELFModuleCache::GetModuleInfo(path, info, true));
+  std::memcpy(digest, info.md5, sizeof(info.md5));
+  return kSuccess;
+#else
+  return kErrorUnsupported;
+#endif
+}
+
+template <typename T>
+ErrorCode FileOperationsMixin<T>::onQueryModuleInfo(Session &,
+                                                    std::string const &path,
+                                                    ModuleInfo &info) const {
+#if defined(OS_LINUX) || defined(OS_FREEBSD)
+  return Support::ELFModuleCache::GetModuleInfo(path, info);
+#else
+  return kErrorUnsupported;
+#endif
+}
 } // namespace GDBRemote
 } // namespace ds2
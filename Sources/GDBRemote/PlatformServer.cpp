@@ -0,0 +1,233 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "PlatformServer"
+
+#include "DebugServer2/GDBRemote/PlatformServer.h"
+#include "DebugServer2/GDBRemote/PlatformSessionImpl.h"
+#include "DebugServer2/GDBRemote/Session.h"
+#include "DebugServer2/Host/Platform.h"
+#include "DebugServer2/Utils/Log.h"
+#include "DebugServer2/Utils/Stringify.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+using ds2::Host::Platform;
+using ds2::Host::Socket;
+using ds2::Utils::Stringify;
+
+namespace ds2 {
+namespace GDBRemote {
+
+struct PlatformServer::Client {
+  std::unique_ptr<Socket> socket;
+  PlatformSessionImpl impl;
+  Session session;
+  std::chrono::steady_clock::time_point lastActivity;
+  bool busy;
+
+  Client(std::unique_ptr<Socket> socket_, DebugServerPool *debugServerPool)
+      : socket(std::move(socket_)), impl(debugServerPool),
+        session(kCompatibilityModeLLDB),
+        lastActivity(std::chrono::steady_clock::now()), busy(false) {
+    session.setDelegate(&impl);
+    session.create(socket.get());
+  }
+};
+
+PlatformServer::PlatformServer(std::unique_ptr<Socket> server,
+                               DebugServerPool *debugServerPool,
+                               size_t maxClients, unsigned idleTimeout)
+    : _server(std::move(server)), _debugServerPool(debugServerPool),
+      _maxClients(maxClients), _idleTimeout(idleTimeout), _epollfd(-1),
+      _terminated(false) {}
+
+PlatformServer::~PlatformServer() {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _terminated = true;
+  }
+  _cond.notify_all();
+
+  for (auto &worker : _workers) {
+    worker.join();
+  }
+
+  for (auto client : _clients) {
+    delete client;
+  }
+
+  if (_epollfd >= 0) {
+    ::close(_epollfd);
+  }
+}
+
+ErrorCode PlatformServer::run(size_t numWorkers) {
+  _epollfd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (_epollfd < 0) {
+    return Platform::TranslateError();
+  }
+
+  // The server socket is the only one registered without a client pointer.
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  if (::epoll_ctl(_epollfd, EPOLL_CTL_ADD, _server->handle(), &event) < 0) {
+    return Platform::TranslateError();
+  }
+
+  for (size_t n = 0; n < std::max<size_t>(numWorkers, 1); n++) {
+    _workers.emplace_back(&PlatformServer::workerThread, this);
+  }
+
+  static int const kMaxEvents = 64;
+  struct epoll_event events[kMaxEvents];
+
+  for (;;) {
+    // Wake up every second to expire idle clients if we need to.
+    int timeout = (_idleTimeout.count() > 0) ? 1000 : -1;
+    int nevents = ::epoll_wait(_epollfd, events, kMaxEvents, timeout);
+    if (nevents < 0) {
+      if (errno == EINTR)
+        continue;
+      return Platform::TranslateError();
+    }
+
+    for (int n = 0; n < nevents; n++) {
+      if (events[n].data.ptr == nullptr) {
+        acceptClient();
+        continue;
+      }
+
+      // Clients are registered with EPOLLONESHOT, so we won't hear about this
+      // one again until a worker is done with it and re-arms it.
+      auto client = static_cast<Client *>(events[n].data.ptr);
+      std::lock_guard<std::mutex> guard(_lock);
+      client->busy = true;
+      _ready.push_back(client);
+      _cond.notify_one();
+    }
+
+    if (_idleTimeout.count() > 0) {
+      expireIdleClients();
+    }
+  }
+}
+
+PlatformServer::Stats PlatformServer::stats() {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _stats;
+}
+
+void PlatformServer::acceptClient() {
+  std::unique_ptr<Socket> socket = _server->accept();
+  if (socket == nullptr) {
+    DS2LOG(Warning, "cannot accept client: %s", _server->error().c_str());
+    return;
+  }
+
+  std::lock_guard<std::mutex> guard(_lock);
+
+  if (_maxClients > 0 && _clients.size() >= _maxClients) {
+    _stats.rejectedClients++;
+    DS2LOG(Warning, "rejecting client, %zu clients already connected",
+           _clients.size());
+    return;
+  }
+
+  auto client = new Client(std::move(socket), _debugServerPool);
+  if (!arm(client, EPOLL_CTL_ADD)) {
+    DS2LOG(Warning, "cannot watch client socket: %s",
+           Stringify::Errno(errno));
+    delete client;
+    return;
+  }
+
+  _clients.insert(client);
+  _stats.acceptedClients++;
+  _stats.activeClients = _clients.size();
+  _stats.peakClients = std::max(_stats.peakClients, _stats.activeClients);
+
+  DS2LOG(Debug, "client connected, %zu active, %zu peak", _stats.activeClients,
+         _stats.peakClients);
+}
+
+// Must be called with `_lock` held.
+void PlatformServer::removeClient(Client *client) {
+  ::epoll_ctl(_epollfd, EPOLL_CTL_DEL, client->socket->handle(), nullptr);
+  _clients.erase(client);
+  delete client;
+
+  _stats.activeClients = _clients.size();
+
+  DS2LOG(Debug,
+         "client disconnected, %zu active, %" PRIu64 " accepted, %" PRIu64
+         " rejected, %" PRIu64 " expired, %" PRIu64 " requests",
+         _stats.activeClients, _stats.acceptedClients, _stats.rejectedClients,
+         _stats.expiredClients, _stats.requests);
+}
+
+void PlatformServer::expireIdleClients() {
+  auto now = std::chrono::steady_clock::now();
+
+  std::lock_guard<std::mutex> guard(_lock);
+  for (auto it = _clients.begin(); it != _clients.end();) {
+    Client *client = *it++;
+    if (client->busy || now - client->lastActivity < _idleTimeout)
+      continue;
+
+    _stats.expiredClients++;
+    removeClient(client);
+  }
+}
+
+// Must be called with `_lock` held.
+bool PlatformServer::arm(Client *client, int op) {
+  struct epoll_event event;
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.ptr = client;
+  return ::epoll_ctl(_epollfd, op, client->socket->handle(), &event) == 0;
+}
+
+void PlatformServer::workerThread() {
+  for (;;) {
+    Client *client;
+
+    {
+      std::unique_lock<std::mutex> lock(_lock);
+      _cond.wait(lock, [this] { return _terminated || !_ready.empty(); });
+      if (_terminated)
+        return;
+
+      client = _ready.front();
+      _ready.pop_front();
+    }
+
+    // The socket is readable, so this won't block waiting for data; it
+    // handles whatever the client sent us and returns.
+    bool connected = client->session.receive(/*cooked=*/false);
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _stats.requests++;
+
+    if (!connected || !arm(client, EPOLL_CTL_MOD)) {
+      removeClient(client);
+      continue;
+    }
+
+    client->busy = false;
+    client->lastActivity = std::chrono::steady_clock::now();
+  }
+}
+} // namespace GDBRemote
+} // namespace ds2
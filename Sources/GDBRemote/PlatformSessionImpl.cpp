@@ -16,16 +16,15 @@
 #include "DebugServer2/Host/ProcessSpawner.h"
 #include "DebugServer2/Utils/Log.h"
 
-#include <sstream>
-
 using ds2::Host::Platform;
 using ds2::Host::ProcessSpawner;
 
 namespace ds2 {
 namespace GDBRemote {
 
-PlatformSessionImplBase::PlatformSessionImplBase()
-    : DummySessionDelegateImpl() {}
+PlatformSessionImplBase::PlatformSessionImplBase(
+    DebugServerPool *debugServerPool)
+    : DummySessionDelegateImpl(), _debugServerPool(debugServerPool) {}
 
 ErrorCode PlatformSessionImplBase::onQueryProcessList(
     Session &session, ProcessInfoMatch const &match, bool first,
@@ -37,9 +36,7 @@ ErrorCode PlatformSessionImplBase::onQueryProcessList(
   if (_processIterationState.it == _processIterationState.vals.end())
     return kErrorProcessNotFound;
 
-  if (!Platform::GetProcessInfo(*_processIterationState.it++, info))
-    return kErrorProcessNotFound;
-
+  info = *_processIterationState.it++;
   return kSuccess;
 }
 
@@ -101,52 +98,30 @@ ErrorCode PlatformSessionImplBase::onLaunchDebugServer(Session &session,
                                                        std::string const &host,
                                                        uint16_t &port,
                                                        ProcessId &pid) {
-  ProcessSpawner ps;
-  StringCollection args;
-
-  ps.setExecutable(Platform::GetSelfExecutablePath());
-  args.push_back("slave");
-  if (GetLogLevel() == kLogLevelDebug) {
-    args.push_back("--debug");
-  } else if (GetLogLevel() == kLogLevelPacket) {
-    args.push_back("--remote-debug");
-  }
-  std::string const &outputFilename = GetLogOutputFilename();
-  if (outputFilename.length() > 0) {
-    args.push_back("--log-file");
-    args.push_back(outputFilename);
-  }
-#if defined(OS_POSIX)
-  args.push_back("--setsid");
-#endif
-  ps.setArguments(args);
-  ps.redirectInputToNull();
-  ps.redirectOutputToBuffer();
-
-  ErrorCode error;
-  error = ps.run();
-  if (error != kSuccess)
-    return error;
-  error = ps.wait();
-  if (error != kSuccess)
-    return error;
-
-  if (ps.exitStatus() != 0)
-    return kErrorInvalidArgument;
-
-  std::istringstream ss;
-  ss.str(ps.output());
-  ss >> port >> pid;
+  if (_debugServerPool != nullptr)
+    return _debugServerPool->acquire(port, pid);
 
-  return kSuccess;
+  return DebugServerPool::Launch(port, pid);
 }
 
 void PlatformSessionImplBase::updateProcesses(
     ProcessInfoMatch const &match) const {
-  // TODO(fjricci) we should only add processes that match "match"
+  _processIterationState.vals.clear();
+
+  // Reject on pid and name before anything else is read about a process, the
+  // rest of the criteria need the full process info.
   Platform::EnumerateProcesses(
-      true, UserId(), [&](ds2::ProcessInfo const &info) {
-        _processIterationState.vals.push_back(info.pid);
+      true, UserId(),
+      [&](ProcessId pid, std::string const &path) {
+        return (!match.hasKey("pid") || pid == match.pid) &&
+               match.matchesName(path);
+      },
+      [&](ds2::ProcessInfo const &info) {
+        if (match.matches(info)) {
+          ProcessInfo entry;
+          static_cast<ds2::ProcessInfo &>(entry) = info;
+          _processIterationState.vals.push_back(std::move(entry));
+        }
       });
 
   _processIterationState.it = _processIterationState.vals.begin();
@@ -18,6 +18,7 @@
 #include "DebugServer2/Utils/String.h"
 #include "DebugServer2/Utils/SwapEndian.h"
 
+#include <cctype>
 #include <cstdlib>
 #include <cstring>
 #include <iomanip>
@@ -37,7 +38,8 @@ namespace ds2 {
 namespace GDBRemote {
 
 Session::Session(CompatibilityMode mode)
-    : SessionBase(mode), _threadsInStopReply(false) {
+    : SessionBase(mode), _threadsInStopReply(false),
+      _threadListCursor(kAnyThreadId) {
 #define REGISTER_HANDLER(MODE, MESSAGE, HANDLER)                               \
   do {                                                                         \
     bool REGISTER_HANDLER_result = interpreter().registerHandler(              \
@@ -76,6 +78,7 @@ Session::Session(CompatibilityMode mode)
   REGISTER_HANDLER_EQUALS_1(H);
   REGISTER_HANDLER_EQUALS_1(I);
   REGISTER_HANDLER_EQUALS_1(i);
+  REGISTER_HANDLER_EQUALS_1(jModulesInfo);
   REGISTER_HANDLER_EQUALS_1(jThreadsInfo);
   REGISTER_HANDLER_EQUALS_1(k);
   REGISTER_HANDLER_EQUALS_1(_M);
@@ -87,6 +90,8 @@ Session::Session(CompatibilityMode mode)
   REGISTER_HANDLER_EQUALS_1(QAgent);
   REGISTER_HANDLER_EQUALS_1(QAllow);
   REGISTER_HANDLER_EQUALS_1(QDisableRandomization);
+  REGISTER_HANDLER_EQUALS_1(QEnableDirtyPageTracking);
+  REGISTER_HANDLER_EQUALS_1(QEnableStackSampling);
   REGISTER_HANDLER_EQUALS_1(QEnvironment);
   REGISTER_HANDLER_EQUALS_1(QEnvironmentHexEncoded);
   REGISTER_HANDLER_EQUALS_1(QLaunchArch);
@@ -98,6 +103,7 @@ Session::Session(CompatibilityMode mode)
   REGISTER_HANDLER_EQUALS_1(QSaveRegisterState);
   REGISTER_HANDLER_EQUALS_1(QSetDisableASLR);
   REGISTER_HANDLER_EQUALS_1(QSetEnableAsyncProfiling);
+  REGISTER_HANDLER_EQUALS_1(QSetExpeditedRegisters);
   REGISTER_HANDLER_EQUALS_1(QSetLogging);
   REGISTER_HANDLER_EQUALS_1(QSetMaxPacketSize);
   REGISTER_HANDLER_EQUALS_1(QSetMaxPayloadSize);
@@ -112,6 +118,7 @@ Session::Session(CompatibilityMode mode)
   REGISTER_HANDLER_EQUALS_1(qAttached);
   REGISTER_HANDLER_EQUALS_1(qC);
   REGISTER_HANDLER_EQUALS_1(qCRC);
+  REGISTER_HANDLER_EQUALS_1(qDirtyMemoryRanges);
   REGISTER_HANDLER_EQUALS_1(qFileLoadAddress);
   REGISTER_HANDLER_EQUALS_1(qGDBServerVersion);
   REGISTER_HANDLER_EQUALS_1(qGetPid);
@@ -136,6 +143,7 @@ Session::Session(CompatibilityMode mode)
   REGISTER_HANDLER_EQUALS_1(qProcessInfoPID);
   REGISTER_HANDLER_EQUALS_1(qRcmd);
   REGISTER_HANDLER_STARTS_WITH_1(qRegisterInfo);
+  REGISTER_HANDLER_EQUALS_1(qSaveCore);
   REGISTER_HANDLER_EQUALS_1(qSearch);
   REGISTER_HANDLER_EQUALS_1(qShlibInfoAddr);
   REGISTER_HANDLER_EQUALS_1(qSpeedTest);
@@ -143,6 +151,7 @@ Session::Session(CompatibilityMode mode)
   REGISTER_HANDLER_EQUALS_1(qSupported);
   REGISTER_HANDLER_EQUALS_1(qSupportsDetachAndStayStopped);
   REGISTER_HANDLER_EQUALS_1(qSymbol);
+  REGISTER_HANDLER_EQUALS_1(qSymbolicateAddresses);
   REGISTER_HANDLER_STARTS_WITH_1(qThreadStopInfo);
   REGISTER_HANDLER_EQUALS_1(qThreadExtraInfo);
   REGISTER_HANDLER_EQUALS_1(qTStatus);
@@ -184,6 +193,12 @@ Session::Session(CompatibilityMode mode)
 #undef REGISTER_HANDLER_EQUALS_2
 }
 
+void Session::onDisconnect() {
+  if (_delegate != nullptr) {
+    _delegate->onDisconnect(*this);
+  }
+}
+
 bool Session::ParseList(std::string const &string, char separator,
                         std::function<void(std::string const &)> const &cb) {
   if (string.empty())
@@ -332,7 +347,7 @@ void Session::Handle_QuestionMark(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onQueryThreadStopInfo(*this, ProcessThreadId(), stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -454,7 +469,7 @@ void Session::Handle_bc(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onResume(*this, actions, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -480,7 +495,7 @@ void Session::Handle_bs(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onResume(*this, actions, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -540,7 +555,7 @@ void Session::Handle_C(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onResume(*this, actions, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -592,7 +607,7 @@ void Session::Handle_c(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onResume(*this, actions, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -634,6 +649,37 @@ void Session::Handle_d(ProtocolInterpreter::Handler const &,
   sendError(_delegate->onToggleDebugFlag(*this));
 }
 
+//
+// g and G carry every register at the width of a general purpose register,
+// regsize is in bits. These work on the packet in place, one byte at a time,
+// instead of going through a string and a stream per register.
+//
+static void AppendRegister(std::string &out, uint64_t value, size_t regsize,
+                           Endian endianness) {
+  size_t nbytes = regsize >> 3;
+  for (size_t n = 0; n < nbytes; n++) {
+    size_t index = (endianness == kEndianLittle) ? n : (nbytes - 1 - n);
+    uint8_t byte = value >> (index << 3);
+    out += NibbleToHex(byte >> 4);
+    out += NibbleToHex(byte & 0x0f);
+  }
+}
+
+static uint64_t ParseRegister(char const *hex, size_t regsize,
+                              Endian endianness) {
+  size_t nbytes = regsize >> 3;
+  uint64_t value = 0;
+  for (size_t n = 0; n < nbytes; n++, hex += 2) {
+    // Unavailable bytes (`xx`) are taken as zero.
+    if (!std::isxdigit(static_cast<unsigned char>(hex[0])) ||
+        !std::isxdigit(static_cast<unsigned char>(hex[1])))
+      continue;
+    size_t index = (endianness == kEndianLittle) ? n : (nbytes - 1 - n);
+    value |= static_cast<uint64_t>(HexToByte(hex)) << (index << 3);
+  }
+  return value;
+}
+
 //
 // Packet:        G[;thread:tid]
 // Description:   Write general registers
@@ -663,18 +709,19 @@ void Session::Handle_G(ProtocolInterpreter::Handler const &,
     ptid = _ptids['g'];
   }
 
-  std::vector<uint64_t> regs;
-  size_t regsize = _delegate->getGPRSize() / 8; // Register size in bytes.
-  size_t reglen = regsize * 2; // Two characters per byte in hex.
+  size_t regsize = _delegate->getGPRSize();
+  size_t reglen = regsize >> 2; // Two characters per byte in hex.
+  if (reglen == 0) {
+    sendError(kErrorProcessNotFound);
+    return;
+  }
+
   size_t nargs = args.size() / reglen;
+  std::vector<uint64_t> regs;
+  regs.reserve(nargs);
 
   for (size_t n = 0; n < nargs; n++) {
-    Address address;
-    std::string val = args.substr(n * reglen, reglen);
-    char *eptr;
-
-    parseAddress(address, val.c_str(), &eptr, kEndianNative);
-    regs.push_back(address);
+    regs.push_back(ParseRegister(&args[n * reglen], regsize, kEndianNative));
   }
 
   sendError(_delegate->onWriteGeneralRegisters(*this, ptid, regs));
@@ -712,11 +759,13 @@ void Session::Handle_g(ProtocolInterpreter::Handler const &,
 
   CHK_SEND(_delegate->onReadGeneralRegisters(*this, ptid, regs));
 
-  std::ostringstream ss;
-  for (auto reg : regs) {
-    ss << formatAddress(reg.value, kEndianNative);
+  size_t regsize = _delegate->getGPRSize();
+  std::string data;
+  data.reserve(regs.size() * (regsize >> 2));
+  for (auto const &reg : regs) {
+    AppendRegister(data, reg.value, regsize, kEndianNative);
   }
-  send(ss.str());
+  send(data);
 }
 
 //
@@ -749,9 +798,14 @@ void Session::Handle_H(ProtocolInterpreter::Handler const &,
   }
 
   //
-  // Query if the thread is alive before proceeding.
+  // Query if the thread is alive before proceeding; Hg also selects the
+  // inferior the following packets act on.
   //
-  CHK_SEND(_delegate->onThreadIsAlive(*this, ptid));
+  if (command == 'g') {
+    CHK_SEND(_delegate->onSelectThread(*this, ptid));
+  } else {
+    CHK_SEND(_delegate->onThreadIsAlive(*this, ptid));
+  }
 
   _ptids[command] = ptid;
   sendOK();
@@ -810,7 +864,7 @@ void Session::Handle_I(ProtocolInterpreter::Handler const &,
     StopInfo stop;
     CHK_SEND(_delegate->onResume(*this, actions, stop));
 
-    send(stop.encode(_compatMode, _threadsInStopReply));
+    sendStopReply(stop);
 
     //
     // Update the 'c' and 'g' ptids.
@@ -850,7 +904,7 @@ void Session::Handle_i(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onResume(*this, actions, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -860,6 +914,165 @@ void Session::Handle_i(ProtocolInterpreter::Handler const &,
   }
 }
 
+//
+// Parses the argument of jModulesInfo, a JSON array of objects that each have
+// a "file" and a "triple" string. JSObjects can only parse dictionaries from
+// files, and these objects are flat, so we do it by hand.
+//
+static bool
+ParseModuleSpecs(std::string const &json,
+                 std::vector<std::pair<std::string, std::string>> &specs) {
+  size_t pos = 0;
+
+  auto skipSpaces = [&]() {
+    while (pos < json.size() &&
+           std::isspace(static_cast<unsigned char>(json[pos])))
+      pos++;
+  };
+
+  auto expect = [&](char ch) {
+    skipSpaces();
+    if (pos >= json.size() || json[pos] != ch)
+      return false;
+    pos++;
+    return true;
+  };
+
+  auto parseString = [&](std::string &str) {
+    if (!expect('"'))
+      return false;
+
+    str.clear();
+    while (pos < json.size() && json[pos] != '"') {
+      char ch = json[pos++];
+      if (ch == '\\') {
+        if (pos >= json.size())
+          return false;
+        ch = json[pos++];
+        switch (ch) {
+        case 'b':
+          ch = '\b';
+          break;
+        case 'f':
+          ch = '\f';
+          break;
+        case 'n':
+          ch = '\n';
+          break;
+        case 'r':
+          ch = '\r';
+          break;
+        case 't':
+          ch = '\t';
+          break;
+        case 'u': {
+          if (pos + 4 > json.size())
+            return false;
+          uint32_t cp = std::strtoul(json.substr(pos, 4).c_str(), nullptr, 16);
+          pos += 4;
+          if (cp < 0x80) {
+            str += static_cast<char>(cp);
+          } else if (cp < 0x800) {
+            str += static_cast<char>(0xc0 | (cp >> 6));
+            str += static_cast<char>(0x80 | (cp & 0x3f));
+          } else {
+            str += static_cast<char>(0xe0 | (cp >> 12));
+            str += static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+            str += static_cast<char>(0x80 | (cp & 0x3f));
+          }
+          continue;
+        }
+        default:
+          // '"', '\\' and '/' stand for themselves.
+          break;
+        }
+      }
+      str += ch;
+    }
+
+    if (pos >= json.size())
+      return false;
+    pos++;
+    return true;
+  };
+
+  if (!expect('['))
+    return false;
+
+  skipSpaces();
+  if (pos < json.size() && json[pos] == ']')
+    return true;
+
+  do {
+    std::string file, triple;
+
+    if (!expect('{'))
+      return false;
+
+    do {
+      std::string key, value;
+      if (!parseString(key) || !expect(':'))
+        return false;
+
+      skipSpaces();
+      if (pos < json.size() && json[pos] == '"') {
+        if (!parseString(value))
+          return false;
+      } else {
+        // Not something we look at, skip it.
+        while (pos < json.size() && json[pos] != ',' && json[pos] != '}')
+          pos++;
+      }
+
+      if (key == "file") {
+        file = value;
+      } else if (key == "triple") {
+        triple = value;
+      }
+    } while (expect(','));
+
+    if (!expect('}'))
+      return false;
+
+    specs.emplace_back(file, triple);
+  } while (expect(','));
+
+  return expect(']');
+}
+
+//
+// Packet:        jModulesInfo:[{"file":"<path>","triple":"<triple>"},...]
+// Description:   Same as qModuleInfo for a list of modules, so that all the
+//                libraries of a process can be resolved with one packet.
+//                Modules that can't be found are left out of the reply.
+// Compatibility: LLDB
+//
+void Session::Handle_jModulesInfo(ProtocolInterpreter::Handler const &,
+                                  std::string const &args) {
+  std::vector<std::pair<std::string, std::string>> specs;
+  if (!ParseModuleSpecs(args, specs)) {
+    sendError(kErrorInvalidArgument);
+    return;
+  }
+
+  JSArray modulesObj;
+  for (auto const &spec : specs) {
+    ModuleInfo info;
+    ErrorCode error = _delegate->onQueryModuleInfo(*this, spec.first, info);
+    if (error == kErrorUnsupported) {
+      sendError(error);
+      return;
+    } else if (error != kSuccess) {
+      continue;
+    }
+
+    info.triple = spec.second;
+    modulesObj.append(info.encodeJson());
+  }
+
+  send(modulesObj.toString(), false);
+}
+
 //
 // Packet:        jThreadsInfo
 // Description:   Get information on all threads at once
@@ -896,7 +1109,7 @@ void Session::Handle_k(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onTerminate(*this, ProcessThreadId(), stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -1159,6 +1372,25 @@ void Session::Handle_QPassSignals(ProtocolInterpreter::Handler const &,
   sendError(_delegate->onPassSignals(*this, signals));
 }
 
+//
+// Packet:        QSetExpeditedRegisters:regno[;regno]...
+// Description:   Send the values of the listed registers, numbered as for
+//                the `p` packet, in stop replies in addition to the
+//                default ones, so that the debugger doesn't have to read
+//                them after each stop. An empty list goes back to the
+//                default registers.
+// Compatibility: ds2
+//
+void Session::Handle_QSetExpeditedRegisters(
+    ProtocolInterpreter::Handler const &, std::string const &args) {
+  std::vector<uint32_t> regnos;
+  ParseList(args, ';', [&](std::string const &arg) {
+    regnos.push_back(std::strtoul(arg.c_str(), nullptr, 16));
+  });
+
+  sendError(_delegate->onSetExpeditedRegisters(*this, regnos));
+}
+
 //
 // Packet:        QProgramSignals:signal[;signal]...
 // Description:   Each listed signal may be delivered to the
@@ -1303,6 +1535,34 @@ void Session::Handle_QDisableRandomization(ProtocolInterpreter::Handler const &,
   sendError(_delegate->onDisableASLR(*this, value != 0));
 }
 
+//
+// Packet:        QEnableDirtyPageTracking:enable
+// Description:   Start (1) or stop (0) recording the pages the process
+//                writes to while it runs, see qDirtyMemoryRanges.
+// Compatibility: ds2
+//
+void Session::Handle_QEnableDirtyPageTracking(
+    ProtocolInterpreter::Handler const &, std::string const &args) {
+  uint32_t value = std::strtoul(args.c_str(), nullptr, 16);
+  sendError(_delegate->onEnableDirtyPageTracking(*this, value != 0));
+}
+
+//
+// Packet:        QEnableStackSampling:frequency
+// Description:   Start sampling the call stacks of the process frequency
+//                times per second of CPU time of each of its threads, or
+//                stop when frequency is 0. The samples are read as folded
+//                stacks (`frame;frame;... count` lines, outermost frame
+//                first) with qXfer:stack-samples:read, and are kept until
+//                sampling is started again.
+// Compatibility: ds2
+//
+void Session::Handle_QEnableStackSampling(ProtocolInterpreter::Handler const &,
+                                          std::string const &args) {
+  uint32_t frequency = std::strtoul(args.c_str(), nullptr, 16);
+  sendError(_delegate->onEnableStackSampling(*this, frequency));
+}
+
 //
 // Packet:        QSetMaxPacketSize:size
 // Description:   Tell the debug server the max sized packet the
@@ -1424,20 +1684,25 @@ void Session::Handle_QSetDisableASLR(ProtocolInterpreter::Handler const &,
 //
 void Session::Handle_QSetEnableAsyncProfiling(
     ProtocolInterpreter::Handler const &, std::string const &args) {
-  uint32_t scanType = 0;
+  uint32_t scanType = ProfileData::kScanAll;
   uint32_t interval = 0;
   bool enabled = false;
 
   ParseList(args, ';', [&](std::string const &arg) {
     if (arg.compare(0, 7, "enable:") == 0) {
       enabled = std::strtoul(&arg[7], nullptr, 0) != 0;
-    } else if (arg.compare(0, 9, "scan_type:") == 0) {
-      scanType = std::strtoul(&arg[9], nullptr, 0);
-    } else if (arg.compare(0, 13, "interval_usec:") == 0) {
-      interval = std::strtoul(&arg[13], nullptr, 0);
+    } else if (arg.compare(0, 10, "scan_type:") == 0) {
+      scanType = std::strtoul(&arg[10], nullptr, 0);
+    } else if (arg.compare(0, 14, "interval_usec:") == 0) {
+      interval = std::strtoul(&arg[14], nullptr, 0);
     }
   });
 
+  // Like debugserver, a zero interval disables profiling.
+  if (interval == 0) {
+    enabled = false;
+  }
+
   sendError(_delegate->onEnableAsynchronousProfiling(
       *this, ProcessThreadId(), enabled, interval, scanType));
 }
@@ -1602,19 +1867,19 @@ void Session::Handle_qGetPid(ProtocolInterpreter::Handler const &,
 //
 void Session::Handle_qGetProfileData(ProtocolInterpreter::Handler const &,
                                      std::string const &args) {
-  uint32_t scanType = 0;
+  uint32_t scanType = ProfileData::kScanAll;
 
   ParseList(args, ';', [&](std::string const &arg) {
-    if (arg.compare(0, 9, "scan_type:") == 0) {
-      scanType = std::strtoul(&arg[9], nullptr, 0);
+    if (arg.compare(0, 10, "scan_type:") == 0) {
+      scanType = std::strtoul(&arg[10], nullptr, 0);
     }
   });
 
-  void *TODO;
+  ProfileData data;
   CHK_SEND(
-      _delegate->onQueryProfileData(*this, ProcessThreadId(), scanType, &TODO));
+      _delegate->onQueryProfileData(*this, ProcessThreadId(), scanType, data));
 
-  // send(TODO.encode());
+  send(data.encode(scanType));
 }
 
 //
@@ -1727,33 +1992,30 @@ void Session::Handle_qKillSpawnedProcess(ProtocolInterpreter::Handler const &,
 //
 void Session::Handle_qL(ProtocolInterpreter::Handler const &,
                         std::string const &args) {
-  if (args.length() < 3) {
+  if (args.length() < 4) {
     sendError(kErrorInvalidArgument);
     return;
   }
 
-  ThreadId next = std::strtoul(&args[2], nullptr, 16);
+  bool start = (args[0] == '1');
+  size_t count = std::strtoul(args.substr(1, 2).c_str(), nullptr, 16);
+  ThreadId next = std::strtoul(&args[3], nullptr, 16);
 
-  ThreadId tid;
-  ErrorCode error =
-      _delegate->onQueryThreadList(*this, kAnyProcessId, next, tid);
-  if (error != kSuccess && error != kErrorNotFound) {
+  std::vector<ThreadId> tids;
+  ErrorCode error = _delegate->onQueryThreadList(
+      *this, kAnyProcessId, start ? kAllThreadId : next, count, tids);
+  if (error != kSuccess) {
     sendError(error);
     return;
   }
 
   std::ostringstream ss;
   ss << "qM";
-  if (error == kErrorNotFound) {
-    ss << '0'; // count
-    ss << '1'; // done
-    ss << std::hex << std::setw(8) << std::setfill('0') << next;
-    ss << std::hex << std::setw(8) << std::setfill('0') << 0;
-  } else {
-    ss << '1'; // count
-    ss << '0'; // done
-    ss << std::hex << std::setw(8) << std::setfill('0') << next;
-    ss << std::hex << std::setw(8) << std::setfill('0') << tid;
+  ss << std::hex << std::setw(2) << std::setfill('0') << tids.size();
+  ss << (tids.size() < count ? '1' : '0'); // done
+  ss << std::hex << std::setw(16) << std::setfill('0') << next;
+  for (auto tid : tids) {
+    ss << std::hex << std::setw(16) << std::setfill('0') << tid;
   }
 
   send(ss.str());
@@ -1831,6 +2093,37 @@ void Session::Handle_qMemoryRegionInfo(ProtocolInterpreter::Handler const &,
   send(info.encode());
 }
 
+//
+// Packet:        qDirtyMemoryRanges[:first]
+// Description:   List the ranges of pages written to between the last resume
+//                and the last stop, as `start,length` pairs separated with
+//                semicolons. Replies start with `m` when there are more
+//                ranges to ask for, from index `first`, and `l` otherwise.
+// Compatibility: ds2
+//
+void Session::Handle_qDirtyMemoryRanges(ProtocolInterpreter::Handler const &,
+                                        std::string const &args) {
+  // Keeps replies well under the packet size we advertise.
+  static size_t const kMaxRangesPerReply = 256;
+
+  size_t first = std::strtoul(args.c_str(), nullptr, 16);
+
+  MemoryRange::Collection ranges;
+  CHK_SEND(_delegate->onQueryDirtyMemoryRanges(*this, ranges));
+
+  size_t last = std::min(ranges.size(), first + kMaxRangesPerReply);
+  std::ostringstream ss;
+  ss << (last < ranges.size() ? 'm' : 'l') << std::hex;
+  for (size_t n = first; n < last; n++) {
+    if (n != first) {
+      ss << ';';
+    }
+    ss << ranges[n].start << ',' << ranges[n].length;
+  }
+
+  send(ss.str());
+}
+
 //
 // Packet:        qModuleInfo:<module_path>;<arch triple>
 // Description:   Get information for a module by given module path and
@@ -1840,14 +2133,22 @@ void Session::Handle_qMemoryRegionInfo(ProtocolInterpreter::Handler const &,
 void Session::Handle_qModuleInfo(ProtocolInterpreter::Handler const &,
                                  std::string const &args) {
   size_t semicolon = args.find(';');
-  std::string path(HexToString(args.substr(0, semicolon)));
-  std::string triple(HexToString(args.substr(semicolon + 1)));
-  SharedLibraryInfo info;
+  std::string path(args.substr(0, semicolon));
+  std::string triple;
+  if (semicolon != std::string::npos) {
+    triple = args.substr(semicolon + 1);
+  }
+
+  if (path.size() % 2 != 0 || triple.size() % 2 != 0) {
+    sendError(kErrorInvalidArgument);
+    return;
+  }
 
-  CHK_SEND(_delegate->onQuerySharedLibraryInfo(*this, path, triple, info));
+  ModuleInfo info;
+  CHK_SEND(_delegate->onQueryModuleInfo(*this, HexToString(path), info));
 
-  // FIXME: send the actual response.
-  sendOK();
+  info.triple = HexToString(triple);
+  send(info.encode());
 }
 
 //
@@ -2056,6 +2357,33 @@ void Session::Handle_qRegisterInfo(ProtocolInterpreter::Handler const &,
   send(info.encode());
 }
 
+//
+// Packet:        qSaveCore[;path-hint:<hex path>;]
+// Description:   Writes a core file of the process on the target. The reply
+//                is `core-path:<hex path>;`; the client then fetches the file
+//                with the vFile packets.
+// Compatibility: LLDB
+//
+void Session::Handle_qSaveCore(ProtocolInterpreter::Handler const &,
+                               std::string const &args) {
+  std::string pathHint;
+  std::string const key = "path-hint:";
+  if (args.compare(0, key.length(), key) == 0) {
+    size_t end = args.find(';', key.length());
+    std::string hex = args.substr(key.length(), end - key.length());
+    if (hex.size() % 2 != 0) {
+      sendError(kErrorInvalidArgument);
+      return;
+    }
+    pathHint = HexToString(hex);
+  }
+
+  std::string path;
+  CHK_SEND(_delegate->onSaveCore(*this, pathHint, path));
+
+  send("core-path:" + ToHex(path) + ";");
+}
+
 //
 // Packet:        qSearch:memory:address;length;search-pattern
 // Description:   Search in the memory interval specified the pattern.
@@ -2291,6 +2619,55 @@ void Session::Handle_qSymbol(ProtocolInterpreter::Handler const &,
   }
 }
 
+//
+// Packet:        qSymbolicateAddresses:<addr>[,<addr>...]
+// Description:   Resolve addresses to the module and symbol they fall in,
+//                using the symbol tables of the modules on the target so that
+//                they don't have to be transferred.
+// Compatibility: ds2
+//
+// Notes:
+// The reply has one entry per address, in order, separated by ';'. Each entry
+// is <module>,<symbol>,<offset> with the module path and symbol name hex
+// encoded, and the offset from the start of the symbol. Addresses that are in
+// a module but not in a symbol have an empty symbol name and the offset from
+// the load bias of the module; addresses outside of any module also have an
+// empty module path, and the address itself as offset.
+//
+void Session::Handle_qSymbolicateAddresses(ProtocolInterpreter::Handler const &,
+                                           std::string const &args) {
+  std::vector<uint64_t> addresses;
+  char const *cur = args.c_str();
+  while (*cur != '\0') {
+    char *eptr;
+    addresses.push_back(std::strtoull(cur, &eptr, 16));
+    if (eptr == cur || (*eptr != ',' && *eptr != '\0')) {
+      sendError(kErrorInvalidArgument);
+      return;
+    }
+    cur = (*eptr == ',') ? eptr + 1 : eptr;
+  }
+
+  if (addresses.empty()) {
+    sendError(kErrorInvalidArgument);
+    return;
+  }
+
+  SymbolInfo::Collection symbols;
+  CHK_SEND(_delegate->onSymbolicateAddresses(*this, addresses, symbols));
+
+  std::ostringstream ss;
+  for (size_t n = 0; n < symbols.size(); n++) {
+    if (n != 0) {
+      ss << ';';
+    }
+    ss << ToHex(symbols[n].module) << ',' << ToHex(symbols[n].name) << ','
+       << std::hex << symbols[n].offset;
+  }
+
+  send(ss.str());
+}
+
 //
 // Packet:        qThreadStopInfo thread-id
 // Description:   Get information about why the thread specified is stopped.
@@ -2311,7 +2688,7 @@ void Session::Handle_qThreadStopInfo(ProtocolInterpreter::Handler const &,
     _ptids['c'] = _ptids['g'] = stop.ptid;
   }
 
-  JSArray threadsStopInfo;
+  std::string threadsStopInfo;
   CHK_SEND(_delegate->createThreadsStopInfo(*this, threadsStopInfo));
 
   send(stop.encodeWithAllThreads(_compatMode, threadsStopInfo));
@@ -2492,15 +2869,15 @@ void Session::Handle_qfProcessInfo(ProtocolInterpreter::Handler const &,
 
   ParseList(args, ';', [&](std::string const &arg) {
     std::string key, value;
-    size_t colon = args.find(':');
+    size_t colon = arg.find(':');
     if (colon == std::string::npos)
       return;
 
-    key = args.substr(0, colon);
-    value = args.substr(colon + 1);
+    key = arg.substr(0, colon);
+    value = arg.substr(colon + 1);
 
     if (key == "name") {
-      match.name = value;
+      match.name = HexToString(value);
     } else if (key == "name_match") {
       match.nameMatch = value;
     } else if (key == "pid") {
@@ -2553,21 +2930,7 @@ void Session::Handle_qsProcessInfo(ProtocolInterpreter::Handler const &,
 //
 void Session::Handle_qfThreadInfo(ProtocolInterpreter::Handler const &,
                                   std::string const &) {
-  ThreadId tid;
-  ErrorCode error =
-      _delegate->onQueryThreadList(*this, kAnyProcessId, kAllThreadId, tid);
-  if (error != kSuccess && error != kErrorNotFound) {
-    sendError(error);
-    return;
-  }
-
-  if (error == kErrorNotFound) {
-    send("l");
-  } else {
-    std::ostringstream ss;
-    ss << "m" << getPacketSeparator() << std::hex << tid;
-    send(ss.str());
-  }
+  sendThreadList(kAllThreadId);
 }
 
 //
@@ -2577,21 +2940,52 @@ void Session::Handle_qfThreadInfo(ProtocolInterpreter::Handler const &,
 //
 void Session::Handle_qsThreadInfo(ProtocolInterpreter::Handler const &,
                                   std::string const &) {
-  ThreadId tid;
+  if (_threadListCursor == kAnyThreadId) {
+    send("l");
+    return;
+  }
+
+  sendThreadList(_threadListCursor);
+}
+
+void Session::sendStopReply(StopInfo const &stop) {
+  _stopReply.clear();
+  stop.encode(_stopReply, _compatMode, _threadsInStopReply);
+  send(_stopReply);
+}
+
+//
+// Sends as many of the threads following lastTid as fit in a packet, so that
+// big processes are listed in a few round trips.
+//
+void Session::sendThreadList(ThreadId lastTid) {
+  std::vector<ThreadId> tids;
+  size_t count = (kMaxPacketSize - 2) / (2 * sizeof(ThreadId) + 1);
   ErrorCode error =
-      _delegate->onQueryThreadList(*this, kAnyProcessId, kAnyThreadId, tid);
-  if (error != kSuccess && error != kErrorNotFound) {
+      _delegate->onQueryThreadList(*this, kAnyProcessId, lastTid, count, tids);
+  if (error != kSuccess) {
+    _threadListCursor = kAnyThreadId;
     sendError(error);
     return;
   }
 
-  if (error == kErrorNotFound) {
+  if (tids.empty()) {
+    _threadListCursor = kAnyThreadId;
     send("l");
-  } else {
-    std::ostringstream ss;
-    ss << "m" << getPacketSeparator() << std::hex << tid;
-    send(ss.str());
+    return;
   }
+
+  std::ostringstream ss;
+  ss << "m" << getPacketSeparator() << std::hex;
+  for (size_t n = 0; n < tids.size(); n++) {
+    if (n != 0) {
+      ss << ',';
+    }
+    ss << tids[n];
+  }
+
+  _threadListCursor = tids.back();
+  send(ss.str());
 }
 
 //
@@ -2664,7 +3058,7 @@ void Session::Handle_S(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onResume(*this, actions, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -2716,7 +3110,7 @@ void Session::Handle_s(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onResume(*this, actions, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -2782,7 +3176,7 @@ void Session::Handle_vAttach(ProtocolInterpreter::Handler const &,
   ProcessId pid = std::strtoul(args.c_str(), nullptr, 16);
   CHK_SEND(_delegate->onAttach(*this, pid, kAttachNow, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -2802,7 +3196,7 @@ void Session::Handle_vAttachName(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onAttach(*this, HexToString(args), kAttachNow, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -2823,7 +3217,7 @@ void Session::Handle_vAttachOrWait(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onAttach(*this, HexToString(args), kAttachOrWait, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -2843,7 +3237,7 @@ void Session::Handle_vAttachWait(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onAttach(*this, HexToString(args), kAttachAndWait, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -2920,7 +3314,7 @@ void Session::Handle_vCont(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onResume(*this, actions, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -3085,9 +3479,7 @@ void Session::Handle_vFile(ProtocolInterpreter::Handler const &,
     if (error != kSuccess) {
       ss << 'x';
     } else {
-      for (unsigned char n : digest) {
-        ss << std::hex << std::setw(2) << std::setfill('0') << n;
-      }
+      ss << ToHex(digest);
     }
   } else if (op == "size") {
     uint64_t size;
@@ -3182,7 +3574,7 @@ void Session::Handle_vKill(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onTerminate(*this, pid, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -3214,7 +3606,7 @@ void Session::Handle_vRun(ProtocolInterpreter::Handler const &,
   StopInfo stop;
   CHK_SEND(_delegate->onRunAttach(*this, filename, arguments, stop));
 
-  send(stop.encode(_compatMode, _threadsInStopReply));
+  sendStopReply(stop);
 
   if (_compatMode != kCompatibilityModeLLDB) {
     //
@@ -3240,7 +3632,7 @@ void Session::Handle_vStopped(ProtocolInterpreter::Handler const &,
   }
 
   if (error == kSuccess) {
-    send(stop.encode(_compatMode, _threadsInStopReply));
+    sendStopReply(stop);
 
     if (_compatMode != kCompatibilityModeLLDB) {
       //
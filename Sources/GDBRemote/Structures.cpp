@@ -14,14 +14,15 @@
 #include "DebugServer2/Utils/Log.h"
 #include "DebugServer2/Utils/String.h"
 #include "DebugServer2/Utils/Stringify.h"
-#include "DebugServer2/Utils/SwapEndian.h"
 #include "JSObjects/JSObjects.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <iomanip>
+#include <regex>
 #include <sstream>
 
 #if defined(OS_POSIX)
@@ -222,6 +223,35 @@ void StopInfo::reasonToString(std::string &key, std::string &val,
       val = "";
     }
     break;
+  case StopInfo::kReasonFork:
+  case StopInfo::kReasonVFork:
+    // GDB wants the child as the value of a "fork" key, LLDB wants it in
+    // addition to the reason (see encodeInfo).
+    if (mode == kCompatibilityModeLLDB) {
+      val = (reason == StopInfo::kReasonFork) ? "fork" : "vfork";
+    } else {
+      key = (reason == StopInfo::kReasonFork) ? "fork" : "vfork";
+      val = ProcessThreadId(childPid, childPid)
+                .encode(kCompatibilityModeGDBMultiprocess);
+    }
+    break;
+  case StopInfo::kReasonVForkDone:
+    // GDB only wants the key.
+    if (mode == kCompatibilityModeLLDB) {
+      val = "vforkdone";
+    } else {
+      key = "vforkdone";
+      val = "";
+    }
+    break;
+  case StopInfo::kReasonExec:
+    if (mode == kCompatibilityModeLLDB) {
+      val = "exec";
+    } else {
+      key = "exec";
+      val = ToHex(execPath);
+    }
+    break;
 #if defined(OS_WIN32)
   case StopInfo::kReasonLibraryEvent:
     key = "library";
@@ -235,113 +265,191 @@ void StopInfo::reasonToString(std::string &key, std::string &val,
   }
 }
 
-std::string StopInfo::encodeInfo(CompatibilityMode mode,
-                                 bool listThreads) const {
-  std::ostringstream ss;
+//
+// The stop reply encoders below append to a single string instead of
+// building intermediate streams, they are on the path of every step.
+//
+static void AppendHex(std::string &out, uint64_t value, size_t width = 1) {
+  char digits[16];
+  size_t ndigits = 0;
+
+  do {
+    digits[ndigits++] = NibbleToHex(value & 0xf);
+    value >>= 4;
+  } while (value != 0);
 
+  for (size_t n = ndigits; n < width; n++) {
+    out += '0';
+  }
+  while (ndigits > 0) {
+    out += digits[--ndigits];
+  }
+}
+
+static void AppendDec(std::string &out, int64_t value) {
+  char digits[20];
+  size_t ndigits = 0;
+  uint64_t magnitude = value < 0 ? -static_cast<uint64_t>(value) : value;
+
+  do {
+    digits[ndigits++] = '0' + (magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+
+  if (value < 0) {
+    out += '-';
+  }
+  while (ndigits > 0) {
+    out += digits[--ndigits];
+  }
+}
+
+static void AppendHexBytes(std::string &out, char const *data, size_t size) {
+  for (size_t n = 0; n < size; n++) {
+    uint8_t byte = data[n];
+    out += NibbleToHex(byte >> 4);
+    out += NibbleToHex(byte & 0x0f);
+  }
+}
+
+// Registers go out in target memory order.
+static void AppendRegisterValue(std::string &out,
+                                Architecture::GPRegisterValue const &reg) {
+  for (size_t n = 0; n < reg.size; n++) {
+#if defined(ENDIAN_BIG)
+    uint8_t byte = reg.value >> ((reg.size - 1 - n) << 3);
+#else
+    uint8_t byte = reg.value >> (n << 3);
+#endif
+    out += NibbleToHex(byte >> 4);
+    out += NibbleToHex(byte & 0x0f);
+  }
+}
+
+void StopInfo::encodeInfo(std::string &out, CompatibilityMode mode,
+                          bool listThreads) const {
   CompatibilityMode threadMode =
       (mode == kCompatibilityModeLLDB) ? kCompatibilityModeLLDBThread : mode;
 
-  ss << "thread:" << ptid.encode(threadMode);
+  out += "thread:";
+  out += ptid.encode(threadMode);
   if (!threadName.empty()) {
-    ss << ';' << "name:" << threadName;
+    out += ";name:";
+    out += threadName;
   }
   if (!(core < 0)) {
-    ss << ';' << "core:" << core;
+    out += ";core:";
+    AppendDec(out, core);
   }
 
   std::string key, val;
   reasonToString(key, val, mode);
 
-  if (!key.empty() && !val.empty()) {
-    ss << ';' << key << ':' << val;
+  if (!key.empty() && (!val.empty() || reason == StopInfo::kReasonVForkDone)) {
+    out += ';';
+    out += key;
+    out += ':';
+    out += val;
   }
 
   if (watchpointAddress) {
     getWatchpointInfo(key, val, mode, mode == kCompatibilityModeLLDB);
-    ss << ';' << key << ':' << val;
+    out += ';';
+    out += key;
+    out += ':';
+    out += val;
   }
 
   if (reason == StopInfo::kReasonSignalStop) {
-    ss << ';' << "signal:" << signal;
+    out += ";signal:";
+    AppendDec(out, signal);
+  }
+
+  if (mode == kCompatibilityModeLLDB &&
+      (reason == StopInfo::kReasonFork || reason == StopInfo::kReasonVFork)) {
+    out += (reason == StopInfo::kReasonFork) ? ";fork:" : ";vfork:";
+    out += ProcessThreadId(childPid, childPid)
+               .encode(kCompatibilityModeGDBMultiprocess);
   }
 
   if (listThreads) {
-    ss << ';' << "threads:";
+    out += ";threads:";
     if (threads.empty()) {
       //
       // Best effort, send only this thread.
       //
-      ss << ptid.encode(threadMode);
+      out += ptid.encode(threadMode);
     } else {
-      bool first = true;
-      for (auto &tid : threads) {
-        if (!first) {
-          ss << ',';
+      for (size_t n = 0; n < threads.size(); n++) {
+        if (n != 0) {
+          out += ',';
         }
-        ss << HEX0 << tid;
-        first = false;
+        AppendHex(out, threads[n]);
       }
     }
-  }
 
-  return ss.str();
-}
-
-void StopInfo::encodeRegisters(std::map<std::string, std::string> &regs,
-                               bool hexIndex) const {
-  for (auto &reg : registers) {
-    std::stringstream regNum;
-    std::stringstream regVal;
-    size_t regsize = reg.second.size << 3;
-
-    if (hexIndex) {
-      regNum << HEX(2) << (reg.first & 0xff);
-    } else {
-      regNum << DEC << reg.first;
+    // Saves LLDB a register read per thread to find where they are. It
+    // only uses this if there is a PC for every thread.
+    if (mode == kCompatibilityModeLLDB && !threadPCs.empty() &&
+        threadPCs.size() == threads.size()) {
+      out += ";thread-pcs:";
+      for (size_t n = 0; n < threadPCs.size(); n++) {
+        if (n != 0) {
+          out += ',';
+        }
+        AppendHex(out, threadPCs[n]);
+      }
     }
-
-#if defined(ENDIAN_BIG)
-    regVal << HEX(regsize >> 2) << reg.second.value;
-#else
-    regVal << HEX(regsize >> 2) << (Swap64(reg.second.value) >> (64 - regsize));
-#endif
-
-    regs.insert(std::make_pair(regNum.str(), regVal.str()));
   }
 }
 
-std::string StopInfo::encodeRegisters() const {
-  std::ostringstream ss;
+void StopInfo::encodeRegisters(std::string &out) const {
   bool first = true;
-  std::map<std::string, std::string> regs;
-  encodeRegisters(regs, true);
 
-  for (auto &reg : regs) {
+  for (auto const &reg : registers) {
     if (!first) {
-      ss << ';';
+      out += ';';
     }
-
-    ss << reg.first << ':' << reg.second;
-
+    AppendHex(out, reg.first & 0xff, 2);
+    out += ':';
+    AppendRegisterValue(out, reg.second);
     first = false;
   }
 
-  return ss.str();
+  size_t offset = 0;
+  for (auto const &reg : expeditedRegisters) {
+    // Already sent as a general purpose register.
+    if (registers.find(reg.first) == registers.end()) {
+      if (!first) {
+        out += ';';
+      }
+      AppendHex(out, reg.first, 2);
+      out += ':';
+      AppendHexBytes(out, &expeditedData[offset], reg.second);
+      first = false;
+    }
+    offset += reg.second;
+  }
 }
 
 std::string StopInfo::encode(CompatibilityMode mode, bool listThreads) const {
+  std::string out;
+  encode(out, mode, listThreads);
+  return out;
+}
+
+void StopInfo::encode(std::string &out, CompatibilityMode mode,
+                      bool listThreads) const {
   // We shouldn't be trying to encode something that has no stop event.
   DS2ASSERT(event != kEventNone);
 
-  std::ostringstream ss;
   if (event == kEventStop && mode == kCompatibilityModeGDBMultiprocess) {
     //
     // We need to have some information in order to
     // have extended stop reason.
     //
     if (!ptid.valid() && core < 0 && reason == StopInfo::kReasonNone &&
-        registers.empty()) {
+        registers.empty() && expeditedRegisters.empty()) {
       //
       // We can use the simpler form.
       //
@@ -349,59 +457,74 @@ std::string StopInfo::encode(CompatibilityMode mode, bool listThreads) const {
     }
   }
 
+  // Registers dominate the size of the reply, followed by the thread list
+  // and its PCs; 128 bytes covers the rest.
+  out.reserve(out.size() + 128 + registers.size() * 24 +
+              expeditedRegisters.size() * 4 + expeditedData.size() * 2 +
+              threads.size() * 34);
+
   switch (event) {
-  case kEventStop:
-    ss << ((mode != kCompatibilityModeGDB) ? 'T' : 'S') << HEX(2);
+  case kEventStop: {
+    out += (mode != kCompatibilityModeGDB) ? 'T' : 'S';
 #if !defined(OS_WIN32)
-    ss << ((reason != StopInfo::kReasonNone) ? (signal & 0xff) : 0);
+    int stopSignal = (reason != StopInfo::kReasonNone) ? (signal & 0xff) : 0;
 #else
     // Windows doesn't have a notion of signals but the GDB protocol still
     // needs some sort of emulation for these.
+    int stopSignal;
     switch (reason) {
     case StopInfo::kReasonNone:
     case StopInfo::kReasonLibraryEvent:
-      ss << 0;
+      stopSignal = 0;
       break;
     case StopInfo::kReasonBreakpoint:
     case StopInfo::kReasonAccessWatchpoint:
     case StopInfo::kReasonReadWatchpoint:
     case StopInfo::kReasonWriteWatchpoint:
-      ss << 5; // SIGTRAP
+      stopSignal = 5; // SIGTRAP
       break;
     case StopInfo::kReasonMemoryError:
-      ss << 11; // SIGSEGV
+      stopSignal = 11; // SIGSEGV
       break;
     case StopInfo::kReasonMemoryAlignment:
-      ss << 7; // SIGBUS
+      stopSignal = 7; // SIGBUS
       break;
     case StopInfo::kReasonMathError:
-      ss << 8; // SIGFPE
+      stopSignal = 8; // SIGFPE
       break;
     case StopInfo::kReasonInstructionError:
-      ss << 4; // SIGILL
+      stopSignal = 4; // SIGILL
       break;
     case StopInfo::kReasonUserException:
-      ss << 30; // SIGUSR1
+      stopSignal = 30; // SIGUSR1
       break;
     default:
       DS2BUG("not implemented");
     }
 #endif
-    ss << DEC;
-    break;
+    AppendHex(out, stopSignal, 2);
+  } break;
 
   case kEventExit:
-    ss << 'W' << HEX(2) << (status & 0xff) << DEC;
+    out += 'W';
+    AppendHex(out, status & 0xff, 2);
+    if (mode == kCompatibilityModeGDBMultiprocess && ptid.validPid()) {
+      out += ";process:";
+      AppendHex(out, ptid.pid);
+    }
     break;
 
   case kEventKill:
-    ss << 'X' << HEX(2);
+    out += 'X';
 #if !defined(OS_WIN32)
-    ss << (signal & 0xff);
+    AppendHex(out, signal & 0xff, 2);
 #else
-    ss << 9; // SIGKILL
+    AppendHex(out, 9, 2); // SIGKILL
 #endif
-    ss << DEC;
+    if (mode == kCompatibilityModeGDBMultiprocess && ptid.validPid()) {
+      out += ";process:";
+      AppendHex(out, ptid.pid);
+    }
     break;
 
   default:
@@ -415,23 +538,29 @@ std::string StopInfo::encode(CompatibilityMode mode, bool listThreads) const {
   //
   if (event == kEventStop && mode != kCompatibilityModeGDB) {
     if (mode == kCompatibilityModeLLDB) {
-      ss << encodeInfo(mode, listThreads) << ';' << encodeRegisters();
+      encodeInfo(out, mode, listThreads);
+      out += ';';
+      encodeRegisters(out);
     } else {
-      ss << encodeRegisters() << ';' << encodeInfo(mode, listThreads);
+      encodeRegisters(out);
+      out += ';';
+      encodeInfo(out, mode, listThreads);
     }
 
-    ss << ';';
+    out += ';';
   }
-  return ss.str();
 }
 
 std::string
 StopInfo::encodeWithAllThreads(CompatibilityMode mode,
-                               const JSArray &threadsStopInfo) const {
-  std::ostringstream ss;
-  ss << encode(mode, true) << "jstopinfo:" << ToHex(threadsStopInfo.toString())
-     << ";";
-  return ss.str();
+                               std::string const &threadsStopInfo) const {
+  std::string out;
+  out.reserve(threadsStopInfo.size() * 2 + 16);
+  encode(out, mode, true);
+  out += "jstopinfo:";
+  AppendHexBytes(out, threadsStopInfo.data(), threadsStopInfo.size());
+  out += ';';
+  return out;
 }
 
 JSDictionary *StopInfo::encodeJson() const {
@@ -463,11 +592,26 @@ JSDictionary *StopInfo::encodeJson() const {
   }
 
   auto regSet = JSDictionary::New();
-  std::map<std::string, std::string> regs;
-  encodeRegisters(regs, false);
+  std::string regNum, regVal;
+
+  for (auto const &reg : registers) {
+    regNum.clear();
+    regVal.clear();
+    AppendDec(regNum, reg.first);
+    AppendRegisterValue(regVal, reg.second);
+    regSet->set(regNum, JSString::New(regVal));
+  }
 
-  for (auto const &reg : regs) {
-    regSet->set(reg.first, JSString::New(reg.second));
+  size_t offset = 0;
+  for (auto const &reg : expeditedRegisters) {
+    if (registers.find(reg.first) == registers.end()) {
+      regNum.clear();
+      regVal.clear();
+      AppendDec(regNum, reg.first);
+      AppendHexBytes(regVal, &expeditedData[offset], reg.second);
+      regSet->set(regNum, JSString::New(regVal));
+    }
+    offset += reg.second;
   }
 
   threadObj->set("registers", regSet);
@@ -628,6 +772,72 @@ std::string ProcessInfo::encode(CompatibilityMode mode,
   return ss.str();
 }
 
+bool ProcessInfoMatch::hasKey(char const *key) const {
+  return std::find(keys.begin(), keys.end(), key) != keys.end();
+}
+
+//
+// `path` is the full path to the executable, LLDB matches against its last
+// component.
+//
+bool ProcessInfoMatch::matchesName(std::string const &path) const {
+  if (!hasKey("name") || name.empty())
+    return true;
+
+  size_t slash = path.rfind('/');
+  std::string base =
+      (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+  if (nameMatch.empty() || nameMatch == "equals") {
+    return base == name || path == name;
+  } else if (nameMatch == "starts_with") {
+    return base.compare(0, name.size(), name) == 0;
+  } else if (nameMatch == "ends_with") {
+    return base.size() >= name.size() &&
+           base.compare(base.size() - name.size(), name.size(), name) == 0;
+  } else if (nameMatch == "contains") {
+    return base.find(name) != std::string::npos;
+  } else if (nameMatch == "regex") {
+    try {
+      return std::regex_search(base, std::regex(name));
+    } catch (std::regex_error const &) {
+      return false;
+    }
+  }
+
+  return false;
+}
+
+bool ProcessInfoMatch::matches(ds2::ProcessInfo const &info) const {
+  if (hasKey("pid") && info.pid != pid)
+    return false;
+  if (hasKey("uid") && info.realUid != realUid)
+    return false;
+  if (hasKey("gid") && info.realGid != realGid)
+    return false;
+#if !defined(OS_WIN32)
+  if (hasKey("parent_pid") && info.parentPid != parentPid)
+    return false;
+  if (hasKey("euid") && info.effectiveUid != effectiveUid)
+    return false;
+  if (hasKey("egid") && info.effectiveGid != effectiveGid)
+    return false;
+#endif
+
+  if (hasKey("triple") && !triple.empty()) {
+    // Only the architecture is compared, and loosely so: "armv7" matches a
+    // process we report as "arm".
+    std::string arch = triple.substr(0, triple.find('-'));
+    std::string infoArch = GetArchName(info.cpuType, info.cpuSubType);
+    if (!arch.empty() && arch != "unknown" &&
+        arch.compare(0, infoArch.size(), infoArch) != 0 &&
+        infoArch.compare(0, arch.size(), arch) != 0)
+      return false;
+  }
+
+  return matchesName(info.name);
+}
+
 std::string RegisterInfo::encode(int xmlSet) const {
   bool xml = (xmlSet >= 0);
 
@@ -801,6 +1011,88 @@ std::string MemoryRegionInfo::encode() const {
   return ss.str();
 }
 
+//
+// LLDB only looks at one of uuid and md5; the build ID is what it uses to
+// find symbol files, so the digest is only sent for files without one.
+//
+std::string ModuleInfo::encode() const {
+  std::ostringstream ss;
+
+  if (!buildId.empty()) {
+    ss << "uuid:" << ToHex(buildId) << ';';
+  } else {
+    ss << "md5:" << ToHex(md5) << ';';
+  }
+  if (!triple.empty()) {
+    ss << "triple:" << ToHex(triple) << ';';
+  }
+  ss << "file_path:" << ToHex(path) << ';';
+  ss << "file_offset:" << HEX0 << fileOffset << ';';
+  ss << "file_size:" << HEX0 << fileSize << ';';
+
+  return ss.str();
+}
+
+JSDictionary *ModuleInfo::encodeJson() const {
+  auto moduleObj = JSDictionary::New();
+
+  if (!buildId.empty()) {
+    moduleObj->set("uuid", JSString::New(ToHex(buildId)));
+  } else {
+    moduleObj->set("md5", JSString::New(ToHex(md5)));
+  }
+  if (!triple.empty()) {
+    moduleObj->set("triple", JSString::New(triple));
+  }
+  moduleObj->set("file_path", JSString::New(path));
+  moduleObj->set("file_offset", JSInteger::New(fileOffset));
+  moduleObj->set("file_size", JSInteger::New(fileSize));
+
+  return moduleObj;
+}
+
+//
+// This follows the format of debugserver, which is what LLDB forwards to its
+// clients; ctx_switches is specific to ds2.
+//
+std::string ProfileData::encode(uint32_t scanType) const {
+  std::ostringstream ss;
+
+  ss << "num_cpu:" << DEC << cpuCount << ';';
+  if (scanType & kScanHostCPU) {
+    ss << "host_user_ticks:" << hostUserTicks << ';'
+       << "host_sys_ticks:" << hostSystemTicks << ';'
+       << "host_idle_ticks:" << hostIdleTicks << ';';
+  }
+
+  if (scanType & kScanCPU) {
+    ss << "elapsed_usec:" << elapsedTime << ';'
+       << "task_used_usec:" << usedTime << ';'
+       << "ctx_switches:" << contextSwitches << ';';
+  }
+
+  if (scanType & kScanThreadsCPU) {
+    for (auto const &thread : threads) {
+      ss << "thread_used_id:" << HEX0 << thread.tid << ';' << DEC
+         << "thread_used_usec:" << thread.usedTime << ';';
+      if (scanType & kScanThreadName) {
+        ss << "thread_used_name:" << ToHex(thread.name) << ';';
+      }
+    }
+  }
+
+  if (scanType & kScanHostMemory) {
+    ss << "total:" << physicalMemory << ';';
+  }
+
+  if (scanType & kScanMemory) {
+    ss << "rsize:" << residentSize << ';';
+  }
+
+  ss << "--end--;";
+  return ss.str();
+}
+
 std::string ServerVersion::encode() const {
   std::ostringstream ss;
   ss << "name:" << name << ';';
@@ -173,7 +173,7 @@ bool Socket::listen(std::string const &address, std::string const &port) {
     return false;
   }
 
-  if (::listen(_handle, 1) < 0) {
+  if (::listen(_handle, SOMAXCONN) < 0) {
     _lastError = SOCK_ERRNO;
     return false;
   }
@@ -227,7 +227,7 @@ bool Socket::listen(std::string const &path, bool abstract) {
     return false;
   }
 
-  if (::listen(_handle, 1) < 0) {
+  if (::listen(_handle, SOMAXCONN) < 0) {
     _lastError = SOCK_ERRNO;
     return false;
   }
@@ -334,8 +334,15 @@ ssize_t Socket::send(void const *buffer, size_t length) {
     return -1;
   }
 
+  // A debugger that goes away must not take us down with SIGPIPE.
+#if defined(MSG_NOSIGNAL)
+  int flags = MSG_NOSIGNAL;
+#else
+  int flags = 0;
+#endif
+
   ssize_t nsent =
-      ::send(_handle, reinterpret_cast<const char *>(buffer), length, 0);
+      ::send(_handle, reinterpret_cast<const char *>(buffer), length, flags);
   if (nsent < 0) {
     int err = SOCK_ERRNO;
     if (err != SOCK_WOULDBLOCK) {
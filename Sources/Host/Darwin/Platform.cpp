@@ -137,6 +137,17 @@ void Platform::EnumerateProcesses(
                                             });
 }
 
+void Platform::EnumerateProcesses(
+    bool allUsers, UserId const &uid,
+    std::function<bool(ProcessId pid, std::string const &path)> const &filter,
+    std::function<void(ProcessInfo const &info)> const &cb) {
+  EnumerateProcesses(allUsers, uid, [&](ProcessInfo const &info) {
+    if (filter(info.pid, info.name)) {
+      cb(info);
+    }
+  });
+}
+
 std::string Platform::GetThreadName(ProcessId pid, ThreadId tid) {
   return Host::Darwin::LibProc::GetThreadName(ProcessThreadId(pid, tid));
 }
@@ -54,6 +54,36 @@ ErrorCode PTrace::readCPUState(ProcessThreadId const &ptid, ProcessInfo const &,
   return kSuccess;
 }
 
+ErrorCode PTrace::readGPRState(ProcessThreadId const &ptid, ProcessInfo const &,
+                               Architecture::CPUState &state) {
+  pid_t pid;
+  CHK(ptidToPid(ptid, pid));
+
+  struct pt_regs gprs;
+  if (wrapPtrace(PTRACE_GETREGS, pid, nullptr, &gprs) < 0)
+    return Platform::TranslateError();
+
+  std::memcpy(state.gp.regs, gprs.uregs, sizeof(state.gp.regs));
+
+  return kSuccess;
+}
+
+ErrorCode PTrace::writeGPRState(ProcessThreadId const &ptid,
+                                ProcessInfo const &,
+                                Architecture::CPUState const &state) {
+  pid_t pid;
+  CHK(ptidToPid(ptid, pid));
+
+  struct pt_regs gprs;
+  std::memcpy(gprs.uregs, state.gp.regs, sizeof(state.gp.regs));
+  gprs.ARM_ORIG_r0 = 0;
+
+  if (wrapPtrace(PTRACE_SETREGS, pid, nullptr, &gprs) < 0)
+    return Platform::TranslateError();
+
+  return kSuccess;
+}
+
 uint32_t PTrace::getStoppointData(ProcessThreadId const &ptid) {
   pid_t pid;
   ErrorCode error = ptidToPid(ptid, pid);
@@ -0,0 +1,229 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "ExecWatcher"
+
+#include "DebugServer2/Host/Linux/ExecWatcher.h"
+#include "DebugServer2/Host/Linux/ProcFS.h"
+#include "DebugServer2/Host/Platform.h"
+#include "DebugServer2/Utils/Log.h"
+#include "DebugServer2/Utils/Stringify.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using ds2::Utils::Stringify;
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+// How often /proc is scanned when we can't use the process connector.
+static std::chrono::milliseconds const kPollInterval(2);
+
+// PROC_EVENT_EXEC moved out of `struct proc_event` in recent kernel headers,
+// use the value directly so that we build against both.
+static uint32_t const kProcEventExec = 0x00000002;
+
+ExecWatcher::ExecWatcher()
+    : _fd(-1), _cancelFd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+      _started(false) {}
+
+ExecWatcher::~ExecWatcher() {
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+  if (_cancelFd >= 0) {
+    ::close(_cancelFd);
+  }
+}
+
+void ExecWatcher::cancel() {
+  uint64_t value = 1;
+  if (_cancelFd >= 0 && ::write(_cancelFd, &value, sizeof(value)) < 0) {
+    DS2LOG(Warning, "unable to cancel exec watch: %s", Stringify::Errno(errno));
+  }
+}
+
+//
+// Waits for up to `timeout` ms (forever if negative) for cancel() to be
+// called, and for `_fd` to become readable if we have it.
+//
+bool ExecWatcher::cancelled(int timeout) {
+  struct pollfd pfds[2];
+  pfds[0].fd = _cancelFd;
+  pfds[0].events = POLLIN;
+  pfds[1].fd = _fd;
+  pfds[1].events = POLLIN;
+
+  int rc = ::poll(pfds, (_fd >= 0) ? 2 : 1, timeout);
+  return rc > 0 && (pfds[0].revents & POLLIN);
+}
+
+ErrorCode ExecWatcher::start() {
+  if (_started)
+    return kSuccess;
+
+  if (!subscribe()) {
+    // Record what's running now so that only processes which exec from now on
+    // are reported.
+    pid_t pid;
+    scan(nullptr, pid);
+  }
+
+  _started = true;
+  return kSuccess;
+}
+
+bool ExecWatcher::subscribe() {
+  _fd = ::socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+  if (_fd < 0) {
+    DS2LOG(Debug, "cannot create netlink socket: %s", Stringify::Errno(errno));
+    return false;
+  }
+
+  struct sockaddr_nl sa;
+  std::memset(&sa, 0, sizeof(sa));
+  sa.nl_family = AF_NETLINK;
+  sa.nl_groups = CN_IDX_PROC;
+  sa.nl_pid = 0;
+
+  if (::bind(_fd, reinterpret_cast<struct sockaddr *>(&sa), sizeof(sa)) < 0) {
+    DS2LOG(Debug, "cannot bind to the process connector: %s, polling /proc",
+           Stringify::Errno(errno));
+    ::close(_fd);
+    _fd = -1;
+    return false;
+  }
+
+  char buffer[NLMSG_SPACE(sizeof(struct cn_msg) +
+                          sizeof(enum proc_cn_mcast_op))];
+  std::memset(buffer, 0, sizeof(buffer));
+
+  auto nlh = reinterpret_cast<struct nlmsghdr *>(buffer);
+  nlh->nlmsg_len =
+      NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+  nlh->nlmsg_type = NLMSG_DONE;
+  nlh->nlmsg_pid = ::getpid();
+
+  auto cn = reinterpret_cast<struct cn_msg *>(NLMSG_DATA(nlh));
+  cn->id.idx = CN_IDX_PROC;
+  cn->id.val = CN_VAL_PROC;
+  cn->len = sizeof(enum proc_cn_mcast_op);
+  *reinterpret_cast<enum proc_cn_mcast_op *>(cn->data) = PROC_CN_MCAST_LISTEN;
+
+  if (::send(_fd, nlh, nlh->nlmsg_len, 0) < 0) {
+    DS2LOG(Debug, "cannot subscribe to process events: %s, polling /proc",
+           Stringify::Errno(errno));
+    ::close(_fd);
+    _fd = -1;
+    return false;
+  }
+
+  DS2LOG(Debug, "watching exec events through the process connector");
+  return true;
+}
+
+ErrorCode ExecWatcher::wait(Matcher const &matcher, pid_t &pid) {
+  CHK(start());
+
+  if (usingNetlink())
+    return waitNetlink(matcher, pid);
+  else
+    return waitPolling(matcher, pid);
+}
+
+ErrorCode ExecWatcher::waitNetlink(Matcher const &matcher, pid_t &pid) {
+  // Large enough for a good number of events per recv().
+  char buffer[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+  for (;;) {
+    if (cancelled(-1))
+      return kErrorInterrupted;
+
+    ssize_t nread = ::recv(_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (nread < 0) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      if (errno == ENOBUFS) {
+        // We missed events because the socket buffer overflowed, there's
+        // nothing to do about it but keep going.
+        DS2LOG(Warning, "process connector overrun, some execs were missed");
+        continue;
+      }
+      return Platform::TranslateError();
+    }
+
+    auto nlh = reinterpret_cast<struct nlmsghdr *>(buffer);
+    for (size_t len = nread; NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+      if (nlh->nlmsg_type == NLMSG_NOOP || nlh->nlmsg_type == NLMSG_ERROR)
+        continue;
+
+      auto cn = reinterpret_cast<struct cn_msg *>(NLMSG_DATA(nlh));
+      auto ev = reinterpret_cast<struct proc_event *>(cn->data);
+      if (static_cast<uint32_t>(ev->what) != kProcEventExec)
+        continue;
+
+      pid_t tgid = ev->event_data.exec.process_tgid;
+      std::string path(ProcFS::GetProcessExecutablePath(tgid));
+      if (path.empty() || !matcher(tgid, path))
+        continue;
+
+      pid = tgid;
+      return kSuccess;
+    }
+  }
+}
+
+ErrorCode ExecWatcher::waitPolling(Matcher const &matcher, pid_t &pid) {
+  for (;;) {
+    if (scan(&matcher, pid))
+      return kSuccess;
+
+    if (cancelled(kPollInterval.count()))
+      return kErrorInterrupted;
+  }
+}
+
+//
+// Updates the list of known processes and returns true if one of them is new
+// or has changed executable, and `matcher` accepts it.
+//
+bool ExecWatcher::scan(Matcher const *matcher, pid_t &pid) {
+  std::map<pid_t, std::string> processes;
+  bool found = false;
+
+  ProcFS::EnumerateProcesses(
+      true, 0, [&](pid_t current, std::string const &path) {
+        auto it = _processes.find(current);
+        bool execed = (it == _processes.end() || it->second != path);
+        processes[current] = path;
+
+        if (!found && execed && matcher != nullptr &&
+            (*matcher)(current, path)) {
+          pid = current;
+          found = true;
+        }
+      });
+
+  _processes.swap(processes);
+  return found;
+}
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
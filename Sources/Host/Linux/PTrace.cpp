@@ -12,6 +12,7 @@
 
 #include "DebugServer2/Host/Linux/PTrace.h"
 #include "DebugServer2/Host/Linux/ExtraWrappers.h"
+#include "DebugServer2/Host/Linux/TracerPool.h"
 #include "DebugServer2/Host/Platform.h"
 #include "DebugServer2/Utils/Log.h"
 
@@ -63,20 +64,62 @@ ErrorCode PTrace::traceThat(ProcessId pid) {
   if (pid <= 0)
     return kErrorInvalidArgument;
 
-  unsigned long traceFlags = PTRACE_O_TRACECLONE;
+  unsigned long traceFlags = PTRACE_O_TRACECLONE | PTRACE_O_TRACEFORK |
+                             PTRACE_O_TRACEVFORK | PTRACE_O_TRACEVFORKDONE |
+                             PTRACE_O_TRACEEXEC;
 
   //
-  // Trace clone and exit events to track threads.
+  // Trace clone and exit events to track threads, fork and vfork events to
+  // follow children, vfork done events to know when a vfork child gave the
+  // address space back, and exec events to know when to reload everything we
+  // know about the process image.
   //
   if (wrapPtrace(PTRACE_SETOPTIONS, pid, nullptr, traceFlags) < 0) {
-    DS2LOG(Warning, "unable to set PTRACE_O_TRACECLONE on pid %d, error=%s",
-           pid, strerror(errno));
+    DS2LOG(Warning, "unable to set ptrace options on pid %d, error=%s", pid,
+           strerror(errno));
     return Platform::TranslateError();
   }
 
   return kSuccess;
 }
 
+ErrorCode PTrace::attach(ProcessId pid) {
+  TracerPool *pool = TracerPool::Get();
+  if (pool == nullptr)
+    return super::attach(pid);
+
+  // Whichever thread makes the request becomes the tracer of `pid`, and of
+  // the threads it creates later on.
+  ErrorCode error;
+  pool->attach(pid, [&]() -> long {
+    error = super::attach(pid);
+    return (error == kSuccess) ? 0 : -1;
+  });
+
+  return error;
+}
+
+ErrorCode PTrace::detach(ProcessId pid) {
+  ErrorCode error = super::detach(pid);
+
+  TracerPool *pool = TracerPool::Get();
+  if (pool != nullptr) {
+    pool->forget(pid);
+  }
+
+  return error;
+}
+
+long PTrace::runOnTracer(pid_t pid, std::function<long()> const &request) {
+  // PTRACE_TRACEME runs in a freshly forked child, which doesn't have any of
+  // the pool threads.
+  TracerPool *pool = TracerPool::Get();
+  if (pool == nullptr || pid <= 0)
+    return request();
+
+  return pool->run(pid, request);
+}
+
 ErrorCode PTrace::kill(ProcessThreadId const &ptid, int signal) {
   if (!ptid.valid())
     return kErrorInvalidArgument;
@@ -285,6 +328,21 @@ ErrorCode PTrace::getSigInfo(ProcessThreadId const &ptid, siginfo_t &si) {
   return kSuccess;
 }
 
+ErrorCode PTrace::getEventMessage(ProcessThreadId const &ptid,
+                                  unsigned long &message) {
+  pid_t pid;
+  CHK(ptidToPid(ptid, pid));
+
+  if (wrapPtrace(PTRACE_GETEVENTMSG, pid, nullptr, &message) < 0)
+    return Platform::TranslateError();
+
+  return kSuccess;
+}
+
+bool PTrace::isEventStop(int status) const {
+  return WIFSTOPPED(status) && (status >> 16) != 0;
+}
+
 ErrorCode PTrace::readRegisterSet(ProcessThreadId const &ptid, int regSetCode,
                                   void *buffer, size_t length) {
   struct iovec iov = {buffer, length};
@@ -300,6 +358,20 @@ ErrorCode PTrace::readRegisterSet(ProcessThreadId const &ptid, int regSetCode,
   return kSuccess;
 }
 
+ErrorCode PTrace::readNoteRegisterSet(ProcessThreadId const &ptid,
+                                      int regSetCode, ByteVector &data) {
+  // Large enough for the biggest XSAVE area we know of.
+  data.resize(16384);
+  struct iovec iov = {data.data(), data.size()};
+
+  if (wrapPtrace(PTRACE_GETREGSET, ptid.validTid() ? ptid.tid : ptid.pid,
+                 regSetCode, &iov) < 0)
+    return Platform::TranslateError();
+
+  data.resize(iov.iov_len);
+  return kSuccess;
+}
+
 ErrorCode PTrace::writeRegisterSet(ProcessThreadId const &ptid, int regSetCode,
                                    void const *buffer, size_t length) {
   struct iovec iov = {const_cast<void *>(buffer), length};
@@ -54,7 +54,9 @@ char const *Platform::GetOSVendorName() {
             return true;
           });
       std::fclose(fp);
-    } else {
+    }
+    // Don't look again on every call when there is nothing to find.
+    if (vendor.empty()) {
       vendor = "unknown";
     }
   }
@@ -104,15 +106,26 @@ bool Platform::GetProcessInfo(ProcessId pid, ProcessInfo &info) {
 void Platform::EnumerateProcesses(
     bool allUsers, UserId const &uid,
     std::function<void(ProcessInfo const &info)> const &cb) {
-  Host::Linux::ProcFS::EnumerateProcesses(allUsers, uid,
-                                          [&](pid_t pid, uid_t uid) {
-                                            ProcessInfo info;
+  EnumerateProcesses(allUsers, uid,
+                     [](ProcessId, std::string const &) { return true; }, cb);
+}
+
+void Platform::EnumerateProcesses(
+    bool allUsers, UserId const &uid,
+    std::function<bool(ProcessId pid, std::string const &path)> const &filter,
+    std::function<void(ProcessInfo const &info)> const &cb) {
+  Host::Linux::ProcFS::EnumerateProcesses(
+      allUsers, uid, [&](pid_t pid, std::string const &path) {
+        ProcessInfo info;
+
+        if (!filter(pid, path))
+          return;
 
-                                            if (!GetProcessInfo(pid, info))
-                                              return;
+        if (!Host::Linux::ProcFS::ReadProcessInfo(pid, path, info))
+          return;
 
-                                            cb(info);
-                                          });
+        cb(info);
+      });
 }
 
 std::string Platform::GetThreadName(ProcessId pid, ThreadId tid) {
@@ -16,12 +16,15 @@
 #include "DebugServer2/Utils/Log.h"
 #include "DebugServer2/Utils/String.h"
 
+#include <atomic>
 #include <cctype>
 #include <cerrno>
 #include <cstdlib>
 #include <cstring>
 #include <elf.h>
 #include <libgen.h>
+#include <map>
+#include <mutex>
 
 using ds2::CPUType;
 using ds2::Support::ELFSupport;
@@ -144,9 +147,14 @@ static void MakePath(char *path, size_t maxsize, pid_t pid, pid_t tid,
   }
 }
 
+static std::atomic<uint64_t> sOpenCount(0);
+
+uint64_t ProcFS::OpenCount() { return sOpenCount; }
+
 int ProcFS::OpenFd(char const *what, int mode) {
   char path[PATH_MAX + 1];
   ds2::Utils::SNPrintf(path, PATH_MAX, "/proc/%s", what);
+  sOpenCount++;
   return open(path, mode);
 }
 
@@ -157,12 +165,14 @@ int ProcFS::OpenFd(pid_t pid, char const *what, int mode) {
 int ProcFS::OpenFd(pid_t pid, pid_t tid, char const *what, int mode) {
   char path[PATH_MAX + 1];
   MakePath(path, PATH_MAX, pid, tid, what);
+  sOpenCount++;
   return open(path, mode);
 }
 
 FILE *ProcFS::OpenFILE(char const *what, char const *mode) {
   char path[PATH_MAX + 1];
   ds2::Utils::SNPrintf(path, PATH_MAX, "/proc/%s", what);
+  sOpenCount++;
   FILE *res = fopen(path, mode);
   if (res == nullptr)
     DS2LOG(Error, "can't open %s: %s", path, strerror(errno));
@@ -177,6 +187,7 @@ FILE *ProcFS::OpenFILE(pid_t pid, pid_t tid, char const *what,
                        char const *mode) {
   char path[PATH_MAX + 1];
   MakePath(path, PATH_MAX, pid, tid, what);
+  sOpenCount++;
   FILE *res = fopen(path, mode);
   if (res == nullptr)
     DS2LOG(Error, "can't open %s: %s", path, strerror(errno));
@@ -186,6 +197,7 @@ FILE *ProcFS::OpenFILE(pid_t pid, pid_t tid, char const *what,
 DIR *ProcFS::OpenDIR(char const *what) {
   char path[PATH_MAX + 1];
   ds2::Utils::SNPrintf(path, PATH_MAX, "/proc/%s", what);
+  sOpenCount++;
   return opendir(path);
 }
 
@@ -196,6 +208,7 @@ DIR *ProcFS::OpenDIR(pid_t pid, char const *what) {
 DIR *ProcFS::OpenDIR(pid_t pid, pid_t tid, char const *what) {
   char path[PATH_MAX + 1];
   MakePath(path, PATH_MAX, pid, tid, what);
+  sOpenCount++;
   return opendir(path);
 }
 
@@ -207,6 +220,7 @@ bool ProcFS::ReadLink(pid_t pid, pid_t tid, char const *what, char *buf,
                       size_t bufsiz) {
   char path[PATH_MAX + 1];
   MakePath(path, PATH_MAX, pid, tid, what);
+  sOpenCount++;
   return readlink(path, buf, bufsiz) == 0;
 }
 
@@ -559,7 +573,82 @@ pid_t ProcFS::GetProcessParentPid(pid_t pid) {
   return ppid;
 }
 
+// This is the tid of the thread that traces `tid`, not a process id.
+pid_t ProcFS::GetThreadTracerPid(pid_t tid) {
+  FILE *fp = OpenFILE(tid, "status");
+  if (fp == nullptr)
+    return 0;
+
+  pid_t tracer = 0;
+  ParseKeyValue(fp, 1024, ':', [&](char const *key, char const *value) -> bool {
+    if (strcmp(key, "TracerPid") == 0) {
+      tracer = std::strtol(value, nullptr, 0);
+      return false;
+    }
+    return true;
+  });
+
+  std::fclose(fp);
+  return tracer;
+}
+
+//
+// Listing processes reads the ELF header of every executable, most of which
+// are shared by many processes (shells, app_process, ...). Cache the result
+// by file identity, which a stat() of /proc/<pid>/exe gives us for much less
+// than an open() and a read().
+//
+namespace {
+struct ELFInfoCacheKey {
+  dev_t dev;
+  ino_t ino;
+  time_t mtime;
+
+  bool operator<(ELFInfoCacheKey const &other) const {
+    if (dev != other.dev)
+      return dev < other.dev;
+    if (ino != other.ino)
+      return ino < other.ino;
+    return mtime < other.mtime;
+  }
+};
+
+static size_t const kELFInfoCacheMaxSize = 4096;
+std::mutex gELFInfoCacheLock;
+std::map<ELFInfoCacheKey, ProcFS::ELFInfo> gELFInfoCache;
+} // namespace
+
 bool ProcFS::GetProcessELFInfo(pid_t pid, ELFInfo &info) {
+  char path[PATH_MAX + 1];
+  struct stat stbuf;
+
+  MakePath(path, PATH_MAX, pid, "exe");
+  if (stat(path, &stbuf) < 0)
+    return false;
+
+  ELFInfoCacheKey key = {stbuf.st_dev, stbuf.st_ino, stbuf.st_mtime};
+
+  {
+    std::lock_guard<std::mutex> guard(gELFInfoCacheLock);
+    auto it = gELFInfoCache.find(key);
+    if (it != gELFInfoCache.end()) {
+      info = it->second;
+      return true;
+    }
+  }
+
+  if (!ReadELFInfo(path, info))
+    return false;
+
+  std::lock_guard<std::mutex> guard(gELFInfoCacheLock);
+  if (gELFInfoCache.size() >= kELFInfoCacheMaxSize) {
+    gELFInfoCache.clear();
+  }
+  gELFInfoCache[key] = info;
+  return true;
+}
+
+bool ProcFS::ReadELFInfo(char const *path, ELFInfo &info) {
   //
   // On Linux, due to the binfmt_misc module, we need to
   // check that the target binary is really an ELF process
@@ -570,7 +659,7 @@ bool ProcFS::GetProcessELFInfo(pid_t pid, ELFInfo &info) {
     Elf64_Ehdr e64;
   } ehdr;
 
-  int fd = ProcFS::OpenFd(pid, "exe");
+  int fd = open(path, O_RDONLY);
   if (fd < 0)
     return false;
 
@@ -752,23 +841,32 @@ std::string ProcFS::GetThreadName(pid_t pid, pid_t tid) {
 }
 
 bool ProcFS::ReadProcessInfo(pid_t pid, ProcessInfo &info) {
+  std::string path(GetProcessExecutablePath(pid));
+  if (path.empty()) {
+    info.clear();
+    return false;
+  }
+
+  return ReadProcessInfo(pid, path, info);
+}
+
+bool ProcFS::ReadProcessInfo(pid_t pid, std::string const &path,
+                             ProcessInfo &info) {
   pid_t ppid;
   uid_t uid, euid;
   gid_t gid, egid;
   ELFInfo elf;
-  std::string path;
 
   info.clear();
 
   if (!ReadProcessIds(pid, ppid, uid, euid, gid, egid) ||
-      !GetProcessELFInfo(pid, elf) ||
-      (path = GetProcessExecutablePath(pid)).empty())
+      !GetProcessELFInfo(pid, elf))
     return false;
 
   info.pid = pid;
   info.parentPid = ppid;
 
-  info.name.swap(path);
+  info.name = path;
 
   info.realUid = uid;
   info.effectiveUid = euid;
@@ -790,40 +888,41 @@ bool ProcFS::ReadProcessInfo(pid_t pid, ProcessInfo &info) {
   return true;
 }
 
-bool ProcFS::EnumerateProcesses(bool allUsers, uid_t uid,
-                                std::function<void(pid_t, uid_t)> const &cb) {
+bool ProcFS::EnumerateProcesses(
+    bool allUsers, uid_t uid,
+    std::function<void(pid_t, std::string const &)> const &cb) {
   DIR *dir = OpenDIR("");
   if (dir == nullptr)
     return false;
 
   while (struct dirent *dp = readdir(dir)) {
-    pid_t pid = strtol(dp->d_name, nullptr, 0);
-    if (pid == 0)
+    if (!isdigit(dp->d_name[0]))
       continue;
 
-    //
-    // Get the uid.
-    //
-    struct stat stbuf;
-    char path[PATH_MAX + 1];
-    MakePath(path, PATH_MAX, pid, "");
-    if (stat(path, &stbuf) < 0)
+    pid_t pid = strtol(dp->d_name, nullptr, 0);
+    if (pid == 0)
       continue;
 
     //
-    // Compare if necessary.
+    // Get the uid and compare if necessary.
     //
-    if (!allUsers && stbuf.st_uid != uid)
-      continue;
+    if (!allUsers) {
+      struct stat stbuf;
+      char path[PATH_MAX + 1];
+      MakePath(path, PATH_MAX, pid, nullptr);
+      if (stat(path, &stbuf) < 0 || stbuf.st_uid != uid)
+        continue;
+    }
 
     //
     // We don't want kernel threads, so exclude them from the list,
     // we know they are kernel threads because "exe" points to nothing.
     //
-    if (GetProcessExecutablePath(pid).empty())
+    std::string path(GetProcessExecutablePath(pid));
+    if (path.empty())
       continue;
 
-    cb(pid, stbuf.st_uid);
+    cb(pid, path);
   }
   closedir(dir);
 
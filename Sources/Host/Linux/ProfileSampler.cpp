@@ -0,0 +1,184 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "ProfileSampler"
+
+#include "DebugServer2/Host/Linux/ProfileSampler.h"
+#include "DebugServer2/Host/Linux/ProcFS.h"
+#include "DebugServer2/Utils/Log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+// Reads the whole of a small /proc file that we keep open.
+static bool ReadFd(int fd, char *buf, size_t size) {
+  if (fd < 0)
+    return false;
+
+  ssize_t nread = ::pread(fd, buf, size - 1, 0);
+  if (nread <= 0)
+    return false;
+
+  buf[nread] = '\0';
+  return true;
+}
+
+static inline uint64_t ToMicroseconds(struct timespec const &ts) {
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+ProfileSampler::ProfileSampler(pid_t pid)
+    : _pid(pid), _hasClock(false), _statmFd(-1), _hostStatFd(-1) {
+  // This clock accounts for all threads, including those that have exited.
+  _hasClock = (::clock_getcpuclockid(pid, &_clock) == 0);
+  _statmFd = ProcFS::OpenFd(pid, "statm", O_RDONLY | O_CLOEXEC);
+  _hostStatFd = ProcFS::OpenFd("stat", O_RDONLY | O_CLOEXEC);
+}
+
+ProfileSampler::~ProfileSampler() {
+  for (auto const &thread : _threads) {
+    closeThread(thread.second);
+  }
+  if (_statmFd >= 0) {
+    ::close(_statmFd);
+  }
+  if (_hostStatFd >= 0) {
+    ::close(_hostStatFd);
+  }
+}
+
+ErrorCode ProfileSampler::sample(ProfileData &data) {
+  data.clear();
+
+  struct timespec ts;
+  if (!_hasClock || ::clock_gettime(_clock, &ts) < 0)
+    return kErrorProcessNotFound;
+  data.usedTime = ToMicroseconds(ts);
+
+  ::clock_gettime(CLOCK_REALTIME, &ts);
+  data.elapsedTime = ToMicroseconds(ts);
+
+  char buf[128];
+  unsigned long long size, resident;
+  if (ReadFd(_statmFd, buf, sizeof(buf)) &&
+      std::sscanf(buf, "%llu %llu", &size, &resident) == 2) {
+    data.residentSize = resident * ::sysconf(_SC_PAGESIZE);
+  }
+
+  sampleHost(data);
+  sampleThreads(data);
+
+  return kSuccess;
+}
+
+void ProfileSampler::sampleHost(ProfileData &data) {
+  data.cpuCount = ::sysconf(_SC_NPROCESSORS_ONLN);
+  data.physicalMemory = static_cast<uint64_t>(::sysconf(_SC_PHYS_PAGES)) *
+                        ::sysconf(_SC_PAGESIZE);
+
+  // Only the first line is needed: "cpu  user nice system idle ...".
+  char buf[256];
+  unsigned long long user, nice, system, idle;
+  if (ReadFd(_hostStatFd, buf, sizeof(buf)) &&
+      std::sscanf(buf, "cpu %llu %llu %llu %llu", &user, &nice, &system,
+                  &idle) == 4) {
+    data.hostUserTicks = user + nice;
+    data.hostSystemTicks = system;
+    data.hostIdleTicks = idle;
+  }
+}
+
+void ProfileSampler::sampleThreads(ProfileData &data) {
+  for (auto &thread : _threads) {
+    thread.second.alive = false;
+  }
+
+  long ticksPerSecond = ::sysconf(_SC_CLK_TCK);
+
+  ProcFS::EnumerateThreads(_pid, [&](pid_t tid) {
+    auto it = _threads.find(tid);
+    if (it == _threads.end()) {
+      ThreadEntry entry;
+      entry.schedstatFd =
+          ProcFS::OpenFd(_pid, tid, "schedstat", O_RDONLY | O_CLOEXEC);
+      entry.commFd = ProcFS::OpenFd(_pid, tid, "comm", O_RDONLY | O_CLOEXEC);
+      it = _threads.insert(std::make_pair(tid, entry)).first;
+    }
+
+    ProfileData::ThreadData thread;
+    thread.tid = tid;
+    thread.usedTime = 0;
+    thread.contextSwitches = 0;
+
+    //
+    // schedstat has the time spent on a CPU in nanoseconds, the time spent
+    // waiting for one, and the number of times the thread was scheduled in.
+    // Kernels without CONFIG_SCHED_INFO don't have it, in which case we use
+    // the tick-based times in stat.
+    //
+    char buf[128];
+    unsigned long long runTime, waitTime, timeslices;
+    if (it->second.schedstatFd < 0) {
+      ProcFS::Stat stat;
+      if (!ProcFS::ReadStat(_pid, tid, stat))
+        return;
+      thread.usedTime = (stat.utime + stat.stime) * 1000000 / ticksPerSecond;
+    } else if (ReadFd(it->second.schedstatFd, buf, sizeof(buf)) &&
+               std::sscanf(buf, "%llu %llu %llu", &runTime, &waitTime,
+                           &timeslices) == 3) {
+      thread.usedTime = runTime / 1000;
+      thread.contextSwitches = timeslices;
+    } else {
+      // The thread exited after we listed it; its tid might get reused, so
+      // don't keep the descriptors around.
+      return;
+    }
+
+    // Threads can be renamed at any time, so the name is re-read as well.
+    if (ReadFd(it->second.commFd, buf, sizeof(buf))) {
+      thread.name = buf;
+      if (!thread.name.empty() && thread.name.back() == '\n') {
+        thread.name.pop_back();
+      }
+    }
+
+    it->second.alive = true;
+    data.contextSwitches += thread.contextSwitches;
+    data.threads.push_back(thread);
+  });
+
+  for (auto it = _threads.begin(); it != _threads.end();) {
+    if (it->second.alive) {
+      ++it;
+      continue;
+    }
+
+    closeThread(it->second);
+    it = _threads.erase(it);
+  }
+}
+
+void ProfileSampler::closeThread(ThreadEntry const &entry) {
+  if (entry.schedstatFd >= 0) {
+    ::close(entry.schedstatFd);
+  }
+  if (entry.commFd >= 0) {
+    ::close(entry.commFd);
+  }
+}
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
@@ -0,0 +1,412 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "SharedMemoryChannel"
+
+#include "DebugServer2/Host/Linux/SharedMemoryChannel.h"
+#include "DebugServer2/Host/Linux/ExtraWrappers.h"
+#include "DebugServer2/Utils/Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+// Size of each ring, must be a power of two. This holds a few packets of the
+// size we advertise.
+static size_t const kRingSize = 256 * 1024;
+
+// The file descriptors sent by the server: the memfd, then the data and
+// space eventfds of the server to client ring, then those of the client to
+// server ring.
+static size_t const kNumFds = 5;
+
+// Replies to the handshake.
+static char const kHandshakeAccepted = 'K';
+static char const kHandshakeRefused = 'E';
+
+char const SharedMemoryChannel::kHandshake[] = "ds2-shm\n";
+
+//
+// head and tail only ever increase; the producer owns head and the consumer
+// tail, so that neither needs a lock. They are kept on separate cache lines.
+//
+struct SharedMemoryChannel::Ring {
+  alignas(64) std::atomic<uint64_t> head;
+  alignas(64) std::atomic<uint64_t> tail;
+  alignas(64) std::atomic<uint32_t> readerWaiting;
+  std::atomic<uint32_t> writerWaiting;
+  std::atomic<uint32_t> closed; // set by the producer
+  alignas(64) uint8_t data[kRingSize];
+};
+
+SharedMemoryChannel::SharedMemoryChannel(Socket *socket)
+    : _socket(socket), _map(nullptr), _connected(false) {
+  _tx.ring = _rx.ring = nullptr;
+  _tx.dataEvent = _tx.spaceEvent = _rx.dataEvent = _rx.spaceEvent = -1;
+}
+
+SharedMemoryChannel::~SharedMemoryChannel() {
+  close();
+
+  if (_map != nullptr) {
+    ::munmap(_map, 2 * sizeof(Ring));
+  }
+  for (int fd : {_tx.dataEvent, _tx.spaceEvent, _rx.dataEvent,
+                 _rx.spaceEvent}) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+}
+
+bool SharedMemoryChannel::setup(int memfd, int const events[4], bool server) {
+  Endpoint serverToClient = {nullptr, events[0], events[1]};
+  Endpoint clientToServer = {nullptr, events[2], events[3]};
+  _tx = server ? serverToClient : clientToServer;
+  _rx = server ? clientToServer : serverToClient;
+
+  void *map = ::mmap(nullptr, 2 * sizeof(Ring), PROT_READ | PROT_WRITE,
+                     MAP_SHARED, memfd, 0);
+  if (map == MAP_FAILED) {
+    DS2LOG(Error, "cannot map shared memory channel: %s", strerror(errno));
+    return false;
+  }
+
+  _map = map;
+  Ring *rings = static_cast<Ring *>(map);
+  _tx.ring = &rings[server ? 0 : 1];
+  _rx.ring = &rings[server ? 1 : 0];
+  _connected = true;
+  return true;
+}
+
+std::unique_ptr<SharedMemoryChannel>
+SharedMemoryChannel::Accept(Socket *socket) {
+  // How long we wait for the rest of a handshake that started arriving.
+  static int const kHandshakeTimeout = 1000;
+
+  struct sockaddr_storage ss;
+  socklen_t sslen = sizeof(ss);
+  if (socket == nullptr || !socket->connected() ||
+      ::getsockname(socket->handle(), reinterpret_cast<sockaddr *>(&ss),
+                    &sslen) < 0 ||
+      ss.ss_family != AF_UNIX)
+    return nullptr;
+
+  //
+  // Debuggers always talk first, so waiting for their first bytes doesn't
+  // delay anything. Peek at them, so that they are left for the session if
+  // this isn't a handshake.
+  //
+  size_t const length = sizeof(kHandshake) - 1;
+  char buf[sizeof(kHandshake)];
+  for (int elapsed = 0;; elapsed++) {
+    if (!socket->wait())
+      return nullptr;
+
+    ssize_t nrecvd = ::recv(socket->handle(), buf, length, MSG_PEEK);
+    if (nrecvd <= 0 || std::memcmp(buf, kHandshake, nrecvd) != 0)
+      return nullptr;
+    if (static_cast<size_t>(nrecvd) == length)
+      break;
+    if (elapsed == kHandshakeTimeout)
+      return nullptr;
+
+    ::usleep(1000);
+  }
+
+  if (::recv(socket->handle(), buf, length, 0) != static_cast<ssize_t>(length))
+    return nullptr;
+
+  auto channel = make_protected_unique(socket);
+  int fds[kNumFds];
+  std::fill(fds, fds + kNumFds, -1);
+
+  fds[0] = ::memfd_create("ds2-channel", MFD_CLOEXEC);
+  bool success = (fds[0] >= 0 && ::ftruncate(fds[0], 2 * sizeof(Ring)) == 0);
+  for (size_t n = 1; success && n < kNumFds; n++) {
+    fds[n] = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    success = (fds[n] >= 0);
+  }
+
+  if (success) {
+    success = channel->setup(fds[0], &fds[1], true);
+  } else {
+    DS2LOG(Error, "cannot create shared memory channel: %s", strerror(errno));
+    for (size_t n = 1; n < kNumFds; n++) {
+      if (fds[n] >= 0) {
+        ::close(fds[n]);
+      }
+    }
+  }
+
+  // The client goes on with the socket if we refuse.
+  char reply = success ? kHandshakeAccepted : kHandshakeRefused;
+  struct iovec iov = {&reply, sizeof(reply)};
+  union {
+    struct cmsghdr header;
+    char buffer[CMSG_SPACE(sizeof(fds))];
+  } control;
+
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (success) {
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  }
+
+  if (::sendmsg(socket->handle(), &msg, MSG_NOSIGNAL) < 0) {
+    DS2LOG(Error, "cannot send shared memory channel: %s", strerror(errno));
+    success = false;
+  }
+
+  // The mapping and the client's copy keep the memory around.
+  if (fds[0] >= 0) {
+    ::close(fds[0]);
+  }
+
+  if (!success)
+    return nullptr;
+
+  DS2LOG(Debug, "using a shared memory channel");
+  return channel;
+}
+
+std::unique_ptr<SharedMemoryChannel>
+SharedMemoryChannel::Connect(Socket *socket) {
+  size_t const length = sizeof(kHandshake) - 1;
+  if (socket == nullptr ||
+      socket->send(kHandshake, length) != static_cast<ssize_t>(length) ||
+      !socket->wait())
+    return nullptr;
+
+  char reply;
+  struct iovec iov = {&reply, sizeof(reply)};
+  union {
+    struct cmsghdr header;
+    char buffer[CMSG_SPACE(kNumFds * sizeof(int))];
+  } control;
+
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buffer;
+  msg.msg_controllen = sizeof(control.buffer);
+
+  if (::recvmsg(socket->handle(), &msg, MSG_CMSG_CLOEXEC) != 1)
+    return nullptr;
+
+  int fds[kNumFds];
+  size_t numFds = 0;
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET &&
+      cmsg->cmsg_type == SCM_RIGHTS) {
+    numFds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    std::memcpy(fds, CMSG_DATA(cmsg), std::min(numFds, kNumFds) * sizeof(int));
+  }
+
+  if (reply != kHandshakeAccepted || numFds != kNumFds) {
+    for (size_t n = 0; n < std::min(numFds, kNumFds); n++) {
+      ::close(fds[n]);
+    }
+    return nullptr;
+  }
+
+  auto channel = make_protected_unique(socket);
+  bool success = channel->setup(fds[0], &fds[1], false);
+  ::close(fds[0]);
+
+  if (!success)
+    return nullptr;
+
+  return channel;
+}
+
+void SharedMemoryChannel::close() {
+  if (!_connected)
+    return;
+
+  _connected = false;
+  _tx.ring->closed.store(1, std::memory_order_release);
+
+  // Whatever the other side waits for, it has to notice we're gone.
+  uint64_t value = 1;
+  for (int fd : {_tx.dataEvent, _rx.spaceEvent}) {
+    if (::write(fd, &value, sizeof(value)) < 0) {
+      DS2LOG(Debug, "cannot signal eventfd: %s", strerror(errno));
+    }
+  }
+}
+
+// Returns 1 once `event` is signaled, 0 on timeout and -1 if the other side
+// went away; it doesn't use the socket once the channel is set up, so
+// anything happening on it means it was closed.
+int SharedMemoryChannel::sleep(int event, int ms) {
+  struct pollfd fds[2];
+  fds[0].fd = event;
+  fds[0].events = POLLIN;
+  fds[1].fd = _socket->handle();
+  fds[1].events = POLLIN;
+
+  int nfds = ::poll(fds, 2, ms);
+  if (nfds < 0)
+    return (errno == EINTR) ? 1 : -1;
+  if (nfds == 0)
+    return 0;
+  if (fds[1].revents != 0)
+    return -1;
+
+  uint64_t value;
+  if (::read(event, &value, sizeof(value)) < 0 && errno != EAGAIN)
+    return -1;
+
+  return 1;
+}
+
+void SharedMemoryChannel::wake(Endpoint const &endpoint, bool data) {
+  // Pairs with the check the other side makes after announcing it waits.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  auto &waiting =
+      data ? endpoint.ring->readerWaiting : endpoint.ring->writerWaiting;
+  if (waiting.exchange(0) == 0)
+    return;
+
+  uint64_t value = 1;
+  if (::write(data ? endpoint.dataEvent : endpoint.spaceEvent, &value,
+              sizeof(value)) < 0) {
+    DS2LOG(Debug, "cannot signal eventfd: %s", strerror(errno));
+  }
+}
+
+bool SharedMemoryChannel::wait(int ms) {
+  Ring *ring = _rx.ring;
+
+  while (_connected) {
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (ring->head.load(std::memory_order_acquire) != tail)
+      return true;
+    if (ring->closed.load(std::memory_order_acquire))
+      break;
+
+    ring->readerWaiting.store(1);
+    if (ring->head.load() != tail || ring->closed.load()) {
+      ring->readerWaiting.store(0, std::memory_order_relaxed);
+      continue;
+    }
+
+    int res = sleep(_rx.dataEvent, ms);
+    ring->readerWaiting.store(0, std::memory_order_relaxed);
+    if (res == 0)
+      return false;
+    if (res < 0) {
+      // Let the data that was sent before be read.
+      if (ring->head.load(std::memory_order_acquire) != tail)
+        return true;
+      break;
+    }
+  }
+
+  _connected = false;
+  return false;
+}
+
+ssize_t SharedMemoryChannel::send(void const *buffer, size_t length) {
+  Ring *ring = _tx.ring;
+  uint8_t const *data = static_cast<uint8_t const *>(buffer);
+  size_t nsent = 0;
+
+  while (nsent < length) {
+    if (!_connected || _rx.ring->closed.load(std::memory_order_acquire))
+      return -1;
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    size_t space = kRingSize - (head - tail);
+
+    if (space == 0) {
+      ring->writerWaiting.store(1);
+      if (ring->tail.load() == tail && sleep(_tx.spaceEvent, -1) < 0) {
+        _connected = false;
+        return -1;
+      }
+      ring->writerWaiting.store(0, std::memory_order_relaxed);
+      continue;
+    }
+
+    size_t size = std::min(space, length - nsent);
+    size_t start = head % kRingSize;
+    size_t first = std::min(size, kRingSize - start);
+    std::memcpy(&ring->data[start], data + nsent, first);
+    std::memcpy(&ring->data[0], data + nsent + first, size - first);
+
+    ring->head.store(head + size, std::memory_order_release);
+    nsent += size;
+    wake(_tx, true);
+  }
+
+  return nsent;
+}
+
+ssize_t SharedMemoryChannel::receive(void *buffer, size_t length) {
+  if (!_connected)
+    return 0;
+
+  Ring *ring = _rx.ring;
+  uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+  uint64_t head = ring->head.load(std::memory_order_acquire);
+  size_t size = std::min<uint64_t>(head - tail, length);
+  if (size == 0)
+    return 0;
+
+  uint8_t *data = static_cast<uint8_t *>(buffer);
+  size_t start = tail % kRingSize;
+  size_t first = std::min(size, kRingSize - start);
+  std::memcpy(data, &ring->data[start], first);
+  std::memcpy(data + first, &ring->data[0], size - first);
+
+  ring->tail.store(tail + size, std::memory_order_release);
+  wake(_rx, false);
+  return size;
+}
+
+bool SharedMemoryChannel::receive(std::string &buffer) {
+  buffer.clear();
+  if (!_connected)
+    return false;
+
+  // Take everything that's there at once rather than by small chunks.
+  Ring *ring = _rx.ring;
+  buffer.resize(ring->head.load(std::memory_order_acquire) -
+                ring->tail.load(std::memory_order_relaxed));
+  buffer.resize(receive(&buffer[0], buffer.size()));
+  return !buffer.empty();
+}
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
@@ -0,0 +1,271 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "StackSampler"
+
+#include "DebugServer2/Host/Linux/StackSampler.h"
+#include "DebugServer2/Host/Linux/ExtraWrappers.h"
+#include "DebugServer2/Host/Linux/ProcFS.h"
+#include "DebugServer2/Host/Platform.h"
+#include "DebugServer2/Utils/Log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using ds2::Host::Platform;
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+// Number of data pages in each ring buffer, must be a power of two.
+static size_t const kBufferPages = 16;
+
+// How often, in milliseconds, the buffers are drained and new threads looked
+// for when the buffers don't fill up faster than that.
+static int const kPollInterval = 100;
+
+StackSampler::StackSampler(pid_t pid, uint32_t frequency)
+    : _pid(pid), _frequency(frequency), _pageSize(::sysconf(_SC_PAGESIZE)),
+      _wakeFd(-1), _lost(0) {}
+
+StackSampler::~StackSampler() {
+  stop();
+  for (auto const &buffer : _buffers) {
+    closeThread(buffer.second);
+  }
+}
+
+ErrorCode StackSampler::start() {
+  // Open the main thread's event here, so that we can report why we can't
+  // sample, e.g.: when perf_event_paranoid forbids it.
+  Buffer buffer;
+  if (!openThread(_pid, buffer))
+    return Platform::TranslateError();
+  buffer.alive = true;
+  _buffers[_pid] = buffer;
+
+  _wakeFd = ::eventfd(0, EFD_CLOEXEC);
+  if (_wakeFd < 0)
+    return Platform::TranslateError();
+
+  updateThreads();
+  _thread = std::thread(&StackSampler::samplerThread, this);
+
+  DS2LOG(Debug, "sampling %zu threads of %d at %uHz", _buffers.size(), _pid,
+         _frequency);
+  return kSuccess;
+}
+
+void StackSampler::stop() {
+  if (_thread.joinable()) {
+    uint64_t value = 1;
+    if (::write(_wakeFd, &value, sizeof(value)) < 0) {
+      DS2LOG(Error, "cannot wake sampler thread: %s", strerror(errno));
+    }
+    _thread.join();
+  }
+
+  if (_wakeFd >= 0) {
+    ::close(_wakeFd);
+    _wakeFd = -1;
+  }
+}
+
+void StackSampler::getStacks(StackCounts &stacks, uint64_t &lost) {
+  std::lock_guard<std::mutex> guard(_lock);
+  stacks = _stacks;
+  lost = _lost;
+}
+
+void StackSampler::samplerThread() {
+  std::vector<struct pollfd> fds;
+
+  for (;;) {
+    fds.clear();
+    fds.push_back({_wakeFd, POLLIN, 0});
+    for (auto const &buffer : _buffers) {
+      fds.push_back({buffer.second.fd, POLLIN, 0});
+    }
+
+    int res = ::poll(fds.data(), fds.size(), kPollInterval);
+    if (res < 0 && errno != EINTR) {
+      DS2LOG(Error, "poll failed: %s", strerror(errno));
+      break;
+    }
+    if (fds[0].revents & POLLIN)
+      break;
+
+    for (auto &buffer : _buffers) {
+      drain(buffer.second);
+    }
+    updateThreads();
+  }
+
+  // Keep what was sampled since the last time we looked.
+  for (auto &buffer : _buffers) {
+    drain(buffer.second);
+    closeThread(buffer.second);
+  }
+  _buffers.clear();
+}
+
+void StackSampler::updateThreads() {
+  for (auto &buffer : _buffers) {
+    buffer.second.alive = false;
+  }
+
+  ProcFS::EnumerateThreads(_pid, [&](pid_t tid) {
+    auto it = _buffers.find(tid);
+    if (it != _buffers.end()) {
+      it->second.alive = true;
+      return;
+    }
+
+    Buffer buffer;
+    if (openThread(tid, buffer)) {
+      buffer.alive = true;
+      _buffers[tid] = buffer;
+    }
+  });
+
+  for (auto it = _buffers.begin(); it != _buffers.end();) {
+    if (it->second.alive) {
+      ++it;
+      continue;
+    }
+
+    drain(it->second);
+    closeThread(it->second);
+    it = _buffers.erase(it);
+  }
+}
+
+bool StackSampler::openThread(pid_t tid, Buffer &buffer) {
+  size_t size = (1 + kBufferPages) * _pageSize;
+
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_SOFTWARE;
+  attr.config = PERF_COUNT_SW_CPU_CLOCK;
+  attr.freq = 1;
+  attr.sample_freq = _frequency;
+  attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_CALLCHAIN;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.exclude_callchain_kernel = 1;
+  // Only wake us up once the buffer is half full.
+  attr.watermark = 1;
+  attr.wakeup_watermark = size / 2;
+
+  buffer.fd = perf_event_open(&attr, tid, -1, -1, 0);
+  if (buffer.fd < 0) {
+    DS2LOG(Debug, "cannot open perf event for thread %d: %s", tid,
+           strerror(errno));
+    return false;
+  }
+  ::fcntl(buffer.fd, F_SETFD, FD_CLOEXEC);
+
+  buffer.map =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, buffer.fd, 0);
+  if (buffer.map == MAP_FAILED) {
+    int error = errno;
+    DS2LOG(Debug, "cannot map perf buffer for thread %d: %s", tid,
+           strerror(error));
+    ::close(buffer.fd);
+    errno = error;
+    return false;
+  }
+
+  return true;
+}
+
+void StackSampler::closeThread(Buffer const &buffer) {
+  ::munmap(buffer.map, (1 + kBufferPages) * _pageSize);
+  ::close(buffer.fd);
+}
+
+void StackSampler::drain(Buffer &buffer) {
+  auto meta = static_cast<struct perf_event_mmap_page *>(buffer.map);
+  uint8_t const *data = static_cast<uint8_t const *>(buffer.map) + _pageSize;
+  size_t dataSize = kBufferPages * _pageSize;
+
+  // Records can wrap around the end of the buffer.
+  auto copy = [&](uint64_t offset, void *dest, size_t length) {
+    size_t start = offset % dataSize;
+    size_t first = std::min(length, dataSize - start);
+    std::memcpy(dest, data + start, first);
+    std::memcpy(static_cast<uint8_t *>(dest) + first, data, length - first);
+  };
+
+  uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+  uint64_t tail = meta->data_tail;
+
+  StackCounts stacks;
+  uint64_t lost = 0;
+  std::vector<uint64_t> values;
+
+  while (tail + sizeof(struct perf_event_header) <= head) {
+    struct perf_event_header header;
+    copy(tail, &header, sizeof(header));
+    if (header.size < sizeof(header) || tail + header.size > head)
+      break;
+
+    values.resize((header.size - sizeof(header)) / sizeof(uint64_t));
+    copy(tail + sizeof(header), values.data(),
+         values.size() * sizeof(uint64_t));
+    tail += header.size;
+
+    if (header.type == PERF_RECORD_LOST && values.size() >= 2) {
+      // { id, lost }
+      lost += values[1];
+      continue;
+    }
+
+    // { ip, nr, ips[nr] }, ips start with the sampled PC.
+    if (header.type != PERF_RECORD_SAMPLE || values.size() < 2 ||
+        values[1] > values.size() - 2)
+      continue;
+
+    Stack stack;
+    for (size_t n = values[1]; n > 0; n--) {
+      // Skip the PERF_CONTEXT_* markers.
+      if (values[n + 1] < static_cast<uint64_t>(PERF_CONTEXT_MAX)) {
+        stack.push_back(values[n + 1]);
+      }
+    }
+    if (stack.empty()) {
+      stack.push_back(values[0]);
+    }
+    stacks[stack]++;
+  }
+
+  __atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+
+  if (stacks.empty() && lost == 0)
+    return;
+
+  std::lock_guard<std::mutex> guard(_lock);
+  for (auto const &stack : stacks) {
+    _stacks[stack.first] += stack.second;
+  }
+  _lost += lost;
+}
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
@@ -0,0 +1,245 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "TracerPool"
+
+#include "DebugServer2/Host/Linux/TracerPool.h"
+#include "DebugServer2/Host/Linux/ExtraWrappers.h"
+#include "DebugServer2/Host/Linux/ProcFS.h"
+#include "DebugServer2/Utils/Log.h"
+
+#include <cerrno>
+
+namespace ds2 {
+namespace Host {
+namespace Linux {
+
+// Index of the shard the current thread is, if any.
+static thread_local int sCurrentShard = -1;
+
+static std::unique_ptr<TracerPool> sTracerPool;
+
+TracerPool::TracerPool(size_t numShards) : _nextShard(0), _terminated(false) {
+  for (size_t n = 0; n < numShards; n++) {
+    _shards.push_back(ds2::make_unique<Shard>());
+    _shards.back()->tid = 0;
+  }
+
+  for (size_t n = 0; n < numShards; n++) {
+    _shards[n]->thread = std::thread(&TracerPool::shardThread, this, n);
+  }
+
+  // Make sure every shard knows its tid before we start looking at tracers.
+  for (size_t n = 0; n < numShards; n++) {
+    post(n, [] {});
+  }
+
+  DS2LOG(Debug, "started %zu tracer threads", numShards);
+}
+
+TracerPool::~TracerPool() {
+  for (auto &shard : _shards) {
+    {
+      std::lock_guard<std::mutex> guard(shard->lock);
+      _terminated = true;
+    }
+    shard->cond.notify_one();
+    shard->thread.join();
+  }
+}
+
+void TracerPool::Initialize(size_t numShards) {
+  if (numShards == 0) {
+    sTracerPool.reset();
+  } else {
+    sTracerPool = ds2::make_unique<TracerPool>(numShards);
+  }
+}
+
+TracerPool *TracerPool::Get() { return sTracerPool.get(); }
+
+long TracerPool::run(pid_t tid, Request const &request) {
+  int index = tracerOf(tid);
+  if (index == kMainTracer || index == sCurrentShard) {
+    return request();
+  }
+
+  long result;
+  int error;
+  post(index, [&] {
+    result = request();
+    error = errno;
+  });
+
+  errno = error;
+  return result;
+}
+
+void TracerPool::runGrouped(std::vector<pid_t> const &tids,
+                            std::function<void(pid_t)> const &cb) {
+  std::vector<std::vector<pid_t>> groups(_shards.size());
+  std::vector<pid_t> mainGroup;
+
+  for (pid_t tid : tids) {
+    int index = tracerOf(tid);
+    if (index == kMainTracer) {
+      mainGroup.push_back(tid);
+    } else {
+      groups[index].push_back(tid);
+    }
+  }
+
+  std::mutex doneLock;
+  std::condition_variable doneCond;
+  size_t pending = 0;
+
+  for (size_t n = 0; n < groups.size(); n++) {
+    if (groups[n].empty())
+      continue;
+
+    pending++;
+    Shard *shard = _shards[n].get();
+    std::vector<pid_t> const *group = &groups[n];
+    {
+      std::lock_guard<std::mutex> guard(shard->lock);
+      shard->tasks.push_back([&, group] {
+        for (pid_t tid : *group) {
+          cb(tid);
+        }
+
+        std::lock_guard<std::mutex> doneGuard(doneLock);
+        if (--pending == 0) {
+          doneCond.notify_one();
+        }
+      });
+    }
+    shard->cond.notify_one();
+  }
+
+  // The threads we trace ourselves are handled while the shards work.
+  for (pid_t tid : mainGroup) {
+    cb(tid);
+  }
+
+  std::unique_lock<std::mutex> lock(doneLock);
+  doneCond.wait(lock, [&] { return pending == 0; });
+}
+
+long TracerPool::attach(pid_t tid, Request const &request) {
+  int index;
+  {
+    std::lock_guard<std::mutex> guard(_tracersLock);
+    index = _nextShard++ % _shards.size();
+    _tracers[tid] = index;
+  }
+
+  long result;
+  int error;
+  post(index, [&] {
+    result = request();
+    error = errno;
+  });
+
+  if (result < 0) {
+    forget(tid);
+  }
+
+  errno = error;
+  return result;
+}
+
+void TracerPool::forget(pid_t tid) {
+  std::lock_guard<std::mutex> guard(_tracersLock);
+  _tracers.erase(tid);
+}
+
+int TracerPool::tracerOf(pid_t tid) {
+  {
+    std::lock_guard<std::mutex> guard(_tracersLock);
+    auto it = _tracers.find(tid);
+    if (it != _tracers.end())
+      return it->second;
+  }
+
+  // We haven't seen this thread yet; it was most likely created by one we
+  // trace, in which case the kernel gave it the same tracer.
+  pid_t tracer = ProcFS::GetThreadTracerPid(tid);
+  if (tracer == 0)
+    return kMainTracer;
+
+  int index = kMainTracer;
+  for (size_t n = 0; n < _shards.size(); n++) {
+    if (_shards[n]->tid == tracer) {
+      index = n;
+      break;
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(_tracersLock);
+  _tracers[tid] = index;
+  return index;
+}
+
+void TracerPool::post(int index, std::function<void()> const &task) {
+  if (index == sCurrentShard) {
+    task();
+    return;
+  }
+
+  Shard *shard = _shards[index].get();
+  std::mutex doneLock;
+  std::condition_variable doneCond;
+  bool done = false;
+
+  {
+    std::lock_guard<std::mutex> guard(shard->lock);
+    shard->tasks.push_back([&] {
+      task();
+
+      std::lock_guard<std::mutex> doneGuard(doneLock);
+      done = true;
+      doneCond.notify_one();
+    });
+  }
+  shard->cond.notify_one();
+
+  std::unique_lock<std::mutex> lock(doneLock);
+  doneCond.wait(lock, [&] { return done; });
+}
+
+void TracerPool::shardThread(int index) {
+  Shard *shard = _shards[index].get();
+  sCurrentShard = index;
+
+  {
+    std::lock_guard<std::mutex> guard(shard->lock);
+    shard->tid = ::gettid();
+  }
+
+  for (;;) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(shard->lock);
+      shard->cond.wait(lock,
+                       [&] { return _terminated || !shard->tasks.empty(); });
+      if (shard->tasks.empty())
+        return;
+
+      task = std::move(shard->tasks.front());
+      shard->tasks.pop_front();
+    }
+
+    task();
+  }
+}
+} // namespace Linux
+} // namespace Host
+} // namespace ds2
@@ -155,6 +155,35 @@ ErrorCode PTrace::readCPUState(ProcessThreadId const &ptid, ProcessInfo const &,
   return kSuccess;
 }
 
+ErrorCode PTrace::readGPRState(ProcessThreadId const &ptid, ProcessInfo const &,
+                               Architecture::CPUState &state) {
+  pid_t pid;
+  CHK(ptidToPid(ptid, pid));
+
+  user_regs_struct gprs;
+  if (wrapPtrace(PTRACE_GETREGS, pid, nullptr, &gprs) < 0)
+    return Platform::TranslateError();
+
+  Architecture::X86::user_to_state32(state, gprs);
+
+  return kSuccess;
+}
+
+ErrorCode PTrace::writeGPRState(ProcessThreadId const &ptid,
+                                ProcessInfo const &,
+                                Architecture::CPUState const &state) {
+  pid_t pid;
+  CHK(ptidToPid(ptid, pid));
+
+  user_regs_struct gprs;
+  Architecture::X86::state32_to_user(gprs, state);
+
+  if (wrapPtrace(PTRACE_SETREGS, pid, nullptr, &gprs) < 0)
+    return Platform::TranslateError();
+
+  return kSuccess;
+}
+
 ErrorCode PTrace::writeCPUState(ProcessThreadId const &ptid,
                                 ProcessInfo const &,
                                 Architecture::CPUState const &state) {
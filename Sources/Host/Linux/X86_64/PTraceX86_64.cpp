@@ -280,6 +280,51 @@ ErrorCode PTrace::readCPUState(ProcessThreadId const &ptid,
   return kSuccess;
 }
 
+ErrorCode PTrace::readGPRState(ProcessThreadId const &ptid,
+                               ProcessInfo const &pinfo,
+                               Architecture::CPUState &state) {
+  pid_t pid;
+  CHK(ptidToPid(ptid, pid));
+
+  user_regs_struct gprs;
+  if (wrapPtrace(PTRACE_GETREGS, pid, nullptr, &gprs) < 0)
+    return Platform::TranslateError();
+
+  if (pinfo.pointerSize == sizeof(uint32_t)) {
+    state.is32 = true;
+    Architecture::X86::user_to_state32(state.state32, gprs);
+  } else {
+    state.is32 = false;
+    Architecture::X86::user_to_state64(state.state64, gprs);
+  }
+
+  return kSuccess;
+}
+
+ErrorCode PTrace::writeGPRState(ProcessThreadId const &ptid,
+                                ProcessInfo const &pinfo,
+                                Architecture::CPUState const &state) {
+  pid_t pid;
+  CHK(ptidToPid(ptid, pid));
+
+  if (pinfo.pointerSize == sizeof(uint32_t) && !state.is32)
+    return kErrorInvalidArgument;
+  else if (pinfo.pointerSize != sizeof(uint32_t) && state.is32)
+    return kErrorInvalidArgument;
+
+  user_regs_struct gprs;
+  if (state.is32) {
+    Architecture::X86::state32_to_user(gprs, state.state32);
+  } else {
+    Architecture::X86::state64_to_user(gprs, state.state64);
+  }
+
+  if (wrapPtrace(PTRACE_SETREGS, pid, nullptr, &gprs) < 0)
+    return Platform::TranslateError();
+
+  return kSuccess;
+}
+
 ErrorCode PTrace::writeCPUState(ProcessThreadId const &ptid,
                                 ProcessInfo const &pinfo,
                                 Architecture::CPUState const &state) {
@@ -156,10 +156,15 @@ ErrorCode PTrace::execute(ProcessThreadId const &ptid, ProcessInfo const &pinfo,
   if (error != kSuccess)
     goto fail;
 
-  // 4. Resume and wait
+  // 4. Resume and wait, going through the events the code may cause (e.g.:
+  //    when it forks)
   error = resume(ptid, pinfo);
-  if (error == kSuccess) {
-    error = wait(ptid);
+  while (error == kSuccess) {
+    int status;
+    error = wait(ptid, &status);
+    if (error != kSuccess || !isEventStop(status))
+      break;
+    error = resume(ptid, pinfo);
   }
 
   if (error == kSuccess) {
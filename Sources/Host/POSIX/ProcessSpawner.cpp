@@ -20,6 +20,7 @@
 #include "DebugServer2/Utils/Stringify.h"
 
 #include <cerrno>
+#include <chrono>
 #include <climits>
 #include <cstdlib>
 #include <cstring>
@@ -580,31 +581,86 @@ bool ProcessSpawner::isRunning() const {
 //
 // Redirector Thread
 //
+
+// Read from `fd` into `buf`, and keep reading for up to `timeout` ms while more
+// data is immediately available. This coalesces bursts of output from chatty
+// inferiors into a few large deliveries rather than many tiny ones.
+static ssize_t read_coalesced(int fd, char *buf, size_t size, int timeout) {
+  auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+  size_t total = 0;
+
+  while (total < size) {
+    ssize_t nread = ::read(fd, buf + total, size - total);
+    if (nread < 0 && errno == EINTR)
+      continue;
+    if (nread <= 0)
+      break;
+    total += nread;
+
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0)
+      break;
+
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (::poll(&pfd, 1, static_cast<int>(remaining.count())) <= 0 ||
+        !(pfd.revents & POLLIN))
+      break;
+  }
+
+  return total;
+}
+
 void ProcessSpawner::redirectionThread() {
+  static size_t const kBufferSize = 64 * 1024;
+  static int const kPollTimeout = 100;
+  static int const kCoalesceTimeout = 5;
+
+  std::vector<char> buf(kBufferSize);
+
   for (;;) {
     struct pollfd pfds[3];
-    struct pollfd *ppfds = pfds;
+    RedirectDescriptor *descriptors[3];
     int nfds = 0;
 
     std::memset(pfds, 0, sizeof(pfds));
     for (size_t n = 0; n < 3; n++) {
       switch (_descriptors[n].mode) {
       case kRedirectBuffer:
-      case kRedirectDelegate:
-        ppfds->fd = _descriptors[n].fd;
-        ppfds->events = (n == 0) ? POLLOUT : POLLIN;
-        ppfds++;
+      case kRedirectDelegate: {
+        // stdout and stderr usually share the same terminal; only poll it
+        // once, otherwise we would block reading an already drained fd.
+        bool duplicate = false;
+        for (int index = 0; index < nfds; index++) {
+          if (pfds[index].fd == _descriptors[n].fd) {
+            duplicate = true;
+            break;
+          }
+        }
+        if (duplicate)
+          break;
+
+        pfds[nfds].fd = _descriptors[n].fd;
+        pfds[nfds].events = (n == 0) ? POLLOUT : POLLIN;
+        descriptors[nfds] = &_descriptors[n];
         nfds++;
-        break;
+      } break;
 
       default:
         break;
       }
     }
 
-    nfds = ::poll(pfds, nfds, 100);
-    if (nfds < 0)
+    int nready = ::poll(pfds, nfds, kPollTimeout);
+    if (nready < 0) {
+      if (errno == EINTR)
+        continue;
       break;
+    }
 
     bool done = false;
     bool hup = false;
@@ -613,30 +669,18 @@ void ProcessSpawner::redirectionThread() {
         hup = true;
       }
 
-      RedirectDescriptor *descriptor = nullptr;
-      for (int index = 0; index < 3; index++) {
-        if (_descriptors[index].fd == pfds[n].fd &&
-            (_descriptors[index].mode == kRedirectBuffer ||
-             _descriptors[index].mode == kRedirectDelegate)) {
-          descriptor = &_descriptors[index];
-          break;
-        }
-      }
-      DS2ASSERT(descriptor != nullptr);
-
-      if (pfds[n].events & POLLIN) {
-        if (pfds[n].revents & POLLIN) {
-          char buf[128];
-          ssize_t nread = ::read(pfds[n].fd, buf, sizeof(buf));
-          if (nread > 0) {
-            if (descriptor->mode == kRedirectBuffer) {
-              _outputBuffer.insert(_outputBuffer.end(), &buf[0], &buf[nread]);
-            } else {
-              descriptor->delegate(buf, nread);
-            }
-            done = true;
-          }
+      if (!(pfds[n].events & POLLIN) || !(pfds[n].revents & POLLIN))
+        continue;
+
+      ssize_t nread =
+          read_coalesced(pfds[n].fd, buf.data(), buf.size(), kCoalesceTimeout);
+      if (nread > 0) {
+        if (descriptors[n]->mode == kRedirectBuffer) {
+          _outputBuffer.insert(_outputBuffer.end(), &buf[0], &buf[nread]);
+        } else {
+          descriptors[n]->delegate(buf.data(), nread);
         }
+        done = true;
       }
     }
 
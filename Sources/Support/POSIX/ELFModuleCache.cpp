@@ -0,0 +1,243 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "ELFModuleCache"
+
+#include "DebugServer2/Support/POSIX/ELFModuleCache.h"
+#include "DebugServer2/Host/Platform.h"
+#include "DebugServer2/Support/POSIX/ELFSupport.h"
+#include "DebugServer2/Utils/Log.h"
+#include "DebugServer2/Utils/MD5.h"
+
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using ds2::Host::Platform;
+
+namespace ds2 {
+namespace Support {
+
+namespace {
+
+struct CacheEntry {
+  off_t size;
+  struct timespec mtime;
+  ModuleInfo info;
+  bool hasMD5;
+};
+} // namespace
+
+static std::mutex sCacheLock;
+static std::map<std::pair<dev_t, ino_t>, CacheEntry> sCache;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static uint8_t const kHostELFData = ELFDATA2LSB;
+#else
+static uint8_t const kHostELFData = ELFDATA2MSB;
+#endif
+
+static inline uint64_t AlignUp(uint64_t value, uint64_t align) {
+  return (value + align - 1) & ~(align - 1);
+}
+
+//
+// Looks for NT_GNU_BUILD_ID in the notes stored at [offset, offset+length).
+//
+static bool FindBuildId(uint8_t const *image, size_t size, uint64_t offset,
+                        uint64_t length, uint64_t align, ByteVector &buildId) {
+  if (offset > size || length > size - offset)
+    return false;
+
+  // Notes are 4-byte aligned, except in 8-byte aligned note segments.
+  align = (align == 8) ? 8 : 4;
+
+  uint64_t end = offset + length;
+  while (offset + sizeof(Elf32_Nhdr) <= end) {
+    // Elf32_Nhdr and Elf64_Nhdr are the same.
+    Elf32_Nhdr nhdr;
+    std::memcpy(&nhdr, image + offset, sizeof(nhdr));
+
+    uint64_t name = offset + sizeof(nhdr);
+    uint64_t desc = name + AlignUp(nhdr.n_namesz, align);
+    uint64_t next = desc + AlignUp(nhdr.n_descsz, align);
+    if (desc + nhdr.n_descsz > end)
+      break;
+
+    if (nhdr.n_type == NT_GNU_BUILD_ID && nhdr.n_namesz == sizeof("GNU") &&
+        std::memcmp(image + name, "GNU", sizeof("GNU")) == 0) {
+      buildId.assign(image + desc, image + desc + nhdr.n_descsz);
+      return true;
+    }
+
+    offset = next;
+  }
+
+  return false;
+}
+
+template <typename Ehdr, typename Phdr, typename Shdr>
+static void ReadELFInfo(uint8_t const *image, size_t size, ModuleInfo &info) {
+  if (size < sizeof(Ehdr))
+    return;
+
+  Ehdr ehdr;
+  std::memcpy(&ehdr, image, sizeof(ehdr));
+  ELFSupport::MachineTypeToCPUType(ehdr.e_machine,
+                                   sizeof(Ehdr) == sizeof(Elf64_Ehdr),
+                                   info.cpuType, info.cpuSubType);
+
+  //
+  // The note segment is all that's left of the notes in stripped files, so
+  // look there first and only fall back to sections if there is none.
+  //
+  if (ehdr.e_phentsize == sizeof(Phdr) && ehdr.e_phoff < size &&
+      ehdr.e_phnum <= (size - ehdr.e_phoff) / sizeof(Phdr)) {
+    for (size_t n = 0; n < ehdr.e_phnum; n++) {
+      Phdr phdr;
+      std::memcpy(&phdr, image + ehdr.e_phoff + n * sizeof(phdr), sizeof(phdr));
+      if (phdr.p_type == PT_NOTE &&
+          FindBuildId(image, size, phdr.p_offset, phdr.p_filesz, phdr.p_align,
+                      info.buildId))
+        return;
+    }
+  }
+
+  if (ehdr.e_shentsize == sizeof(Shdr) && ehdr.e_shoff < size &&
+      ehdr.e_shnum <= (size - ehdr.e_shoff) / sizeof(Shdr)) {
+    for (size_t n = 0; n < ehdr.e_shnum; n++) {
+      Shdr shdr;
+      std::memcpy(&shdr, image + ehdr.e_shoff + n * sizeof(shdr), sizeof(shdr));
+      if (shdr.sh_type == SHT_NOTE &&
+          FindBuildId(image, size, shdr.sh_offset, shdr.sh_size,
+                      shdr.sh_addralign, info.buildId))
+        return;
+    }
+  }
+}
+
+static void ReadModuleInfo(uint8_t const *image, size_t size,
+                           ModuleInfo &info) {
+  if (size >= EI_NIDENT && std::memcmp(image, ELFMAG, SELFMAG) == 0 &&
+      image[EI_DATA] == kHostELFData) {
+    switch (image[EI_CLASS]) {
+    case ELFCLASS32:
+      ReadELFInfo<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr>(image, size, info);
+      break;
+    case ELFCLASS64:
+      ReadELFInfo<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr>(image, size, info);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+ErrorCode ELFModuleCache::GetModuleInfo(std::string const &path,
+                                        ModuleInfo &info, bool needMD5) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return Platform::TranslateError();
+
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    ErrorCode error = Platform::TranslateError();
+    ::close(fd);
+    return error;
+  }
+
+  if (!S_ISREG(st.st_mode)) {
+    ::close(fd);
+    return kErrorInvalidArgument;
+  }
+
+  auto key = std::make_pair(st.st_dev, st.st_ino);
+
+  CacheEntry entry;
+  bool cached = false;
+  {
+    std::lock_guard<std::mutex> guard(sCacheLock);
+    auto it = sCache.find(key);
+    if (it != sCache.end() && it->second.size == st.st_size &&
+        it->second.mtime.tv_sec == st.st_mtim.tv_sec &&
+        it->second.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+      if (it->second.hasMD5 || !needMD5) {
+        ::close(fd);
+        info = it->second.info;
+        info.path = path;
+        return kSuccess;
+      }
+      entry = it->second;
+      cached = true;
+    }
+  }
+
+  if (!cached) {
+    entry.size = st.st_size;
+    entry.mtime = st.st_mtim;
+    entry.info.cpuType = kCPUTypeAny;
+    entry.info.cpuSubType = kCPUSubTypeInvalid;
+    entry.info.fileOffset = 0;
+    entry.info.fileSize = st.st_size;
+    std::memset(entry.info.md5, 0, sizeof(entry.info.md5));
+    entry.hasMD5 = false;
+  }
+
+  uint8_t const *image = nullptr;
+  if (st.st_size != 0) {
+    void *map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      ErrorCode error = Platform::TranslateError();
+      ::close(fd);
+      return error;
+    }
+    image = static_cast<uint8_t const *>(map);
+  }
+  ::close(fd);
+
+  if (!cached) {
+    ReadModuleInfo(image, st.st_size, entry.info);
+  }
+
+  if (needMD5 || entry.info.buildId.empty()) {
+    // The whole file goes through MD5, let the kernel read ahead.
+    if (image != nullptr) {
+      ::madvise(const_cast<uint8_t *>(image), st.st_size, MADV_SEQUENTIAL);
+    }
+    Utils::MD5 md5;
+    md5.update(image, st.st_size);
+    md5.finalize(entry.info.md5);
+    entry.hasMD5 = true;
+  }
+
+  if (image != nullptr) {
+    ::munmap(const_cast<uint8_t *>(image), st.st_size);
+  }
+
+  DS2LOG(Debug, "%s: %zu bytes, %zu byte build ID%s", path.c_str(),
+         static_cast<size_t>(st.st_size), entry.info.buildId.size(),
+         entry.hasMD5 ? ", hashed" : "");
+
+  {
+    std::lock_guard<std::mutex> guard(sCacheLock);
+    sCache[key] = entry;
+  }
+
+  info = entry.info;
+  info.path = path;
+  return kSuccess;
+}
+} // namespace Support
+} // namespace ds2
@@ -0,0 +1,275 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "ELFSymbolTable"
+
+#include "DebugServer2/Support/POSIX/ELFSymbolTable.h"
+#include "DebugServer2/Host/Platform.h"
+#include "DebugServer2/Utils/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using ds2::Host::Platform;
+
+namespace ds2 {
+namespace Support {
+
+namespace {
+
+struct CacheEntry {
+  off_t size;
+  struct timespec mtime;
+  std::shared_ptr<ELFSymbolTable const> table;
+};
+
+struct Symbol {
+  uint64_t start;
+  uint64_t end;
+  uint32_t name;
+  bool global;
+};
+} // namespace
+
+static std::mutex sCacheLock;
+static std::map<std::pair<dev_t, ino_t>, CacheEntry> sCache;
+
+ELFSymbolTable::ELFSymbolTable()
+    : _lowAddress(std::numeric_limits<uint64_t>::max()), _highAddress(0) {}
+
+template <typename Ehdr, typename Phdr, typename Shdr, typename Sym>
+void ELFSymbolTable::load(uint8_t const *image, size_t size) {
+  if (size < sizeof(Ehdr))
+    return;
+
+  Ehdr ehdr;
+  std::memcpy(&ehdr, image, sizeof(ehdr));
+
+  if (ehdr.e_phentsize == sizeof(Phdr) && ehdr.e_phoff < size &&
+      ehdr.e_phnum <= (size - ehdr.e_phoff) / sizeof(Phdr)) {
+    for (size_t n = 0; n < ehdr.e_phnum; n++) {
+      Phdr phdr;
+      std::memcpy(&phdr, image + ehdr.e_phoff + n * sizeof(phdr), sizeof(phdr));
+      if (phdr.p_type != PT_LOAD)
+        continue;
+      _lowAddress = std::min<uint64_t>(_lowAddress, phdr.p_vaddr);
+      _highAddress =
+          std::max<uint64_t>(_highAddress, phdr.p_vaddr + phdr.p_memsz);
+    }
+  }
+
+  if (ehdr.e_shentsize != sizeof(Shdr) || ehdr.e_shoff >= size ||
+      ehdr.e_shnum > (size - ehdr.e_shoff) / sizeof(Shdr))
+    return;
+
+  auto section = [&](size_t index) {
+    Shdr shdr;
+    std::memcpy(&shdr, image + ehdr.e_shoff + index * sizeof(shdr),
+                sizeof(shdr));
+    return shdr;
+  };
+
+  //
+  // .symtab is a superset of .dynsym, the latter is only used for files that
+  // have been stripped.
+  //
+  Shdr symtab;
+  bool found = false;
+  for (size_t n = 0; n < ehdr.e_shnum; n++) {
+    Shdr shdr = section(n);
+    if (shdr.sh_type == SHT_SYMTAB ||
+        (shdr.sh_type == SHT_DYNSYM && !found)) {
+      symtab = shdr;
+      found = true;
+    }
+  }
+
+  if (!found || symtab.sh_link >= ehdr.e_shnum)
+    return;
+
+  Shdr strtab = section(symtab.sh_link);
+  if (symtab.sh_offset > size || symtab.sh_size > size - symtab.sh_offset ||
+      strtab.sh_offset > size || strtab.sh_size > size - strtab.sh_offset)
+    return;
+
+  char const *strings =
+      reinterpret_cast<char const *>(image + strtab.sh_offset);
+  size_t count = symtab.sh_size / sizeof(Sym);
+  std::vector<Symbol> symbols;
+  symbols.reserve(count);
+
+  for (size_t n = 0; n < count; n++) {
+    Sym sym;
+    std::memcpy(&sym, image + symtab.sh_offset + n * sizeof(sym),
+                sizeof(sym));
+
+    // ELF32_ST_* and ELF64_ST_* are the same.
+    unsigned type = ELF32_ST_TYPE(sym.st_info);
+    if (type != STT_FUNC && type != STT_OBJECT && type != STT_GNU_IFUNC)
+      continue;
+    if (sym.st_shndx == SHN_UNDEF || sym.st_shndx == SHN_ABS ||
+        sym.st_value == 0 || sym.st_name >= strtab.sh_size)
+      continue;
+
+    uint64_t start = sym.st_value;
+    if (ehdr.e_machine == EM_ARM && type == STT_FUNC) {
+      // Remove the thumb bit.
+      start &= ~1ULL;
+    }
+
+    char const *name = strings + sym.st_name;
+    size_t length = strnlen(name, strtab.sh_size - sym.st_name);
+    if (length == 0)
+      continue;
+
+    Symbol symbol;
+    symbol.start = start;
+    symbol.end = start + sym.st_size;
+    symbol.name = _strings.size();
+    symbol.global = (ELF32_ST_BIND(sym.st_info) != STB_LOCAL);
+    _strings.append(name, length);
+    _strings.push_back('\0');
+    symbols.push_back(symbol);
+  }
+
+  //
+  // Keep one symbol per address, preferring those that have a size and then
+  // global ones (e.g.: `memcpy` over `__memcpy_avx_unaligned`).
+  //
+  std::sort(symbols.begin(), symbols.end(),
+            [](Symbol const &lhs, Symbol const &rhs) {
+              if (lhs.start != rhs.start)
+                return lhs.start < rhs.start;
+              if ((lhs.end > lhs.start) != (rhs.end > rhs.start))
+                return lhs.end > lhs.start;
+              return lhs.global && !rhs.global;
+            });
+  symbols.erase(std::unique(symbols.begin(), symbols.end(),
+                            [](Symbol const &lhs, Symbol const &rhs) {
+                              return lhs.start == rhs.start;
+                            }),
+                symbols.end());
+
+  _starts.reserve(symbols.size());
+  _ends.reserve(symbols.size());
+  _names.reserve(symbols.size());
+
+  for (size_t n = 0; n < symbols.size(); n++) {
+    uint64_t end = symbols[n].end;
+    if (end == symbols[n].start) {
+      // Symbols without a size extend to the next one.
+      end = (n + 1 < symbols.size()) ? symbols[n + 1].start
+                                     : std::max(_highAddress, end + 1);
+    }
+    _starts.push_back(symbols[n].start);
+    _ends.push_back(end);
+    _names.push_back(symbols[n].name);
+  }
+}
+
+bool ELFSymbolTable::lookup(uint64_t address, char const *&name,
+                            uint64_t &offset) const {
+  auto it = std::upper_bound(_starts.begin(), _starts.end(), address);
+  if (it == _starts.begin())
+    return false;
+
+  size_t index = (it - _starts.begin()) - 1;
+  if (address >= _ends[index])
+    return false;
+
+  name = &_strings[_names[index]];
+  offset = address - _starts[index];
+  return true;
+}
+
+ErrorCode ELFSymbolTable::Get(std::string const &path,
+                              std::shared_ptr<ELFSymbolTable const> &table) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return Platform::TranslateError();
+
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    ErrorCode error = Platform::TranslateError();
+    ::close(fd);
+    return error;
+  }
+
+  if (!S_ISREG(st.st_mode) || st.st_size < EI_NIDENT) {
+    ::close(fd);
+    return kErrorInvalidArgument;
+  }
+
+  auto key = std::make_pair(st.st_dev, st.st_ino);
+
+  {
+    std::lock_guard<std::mutex> guard(sCacheLock);
+    auto it = sCache.find(key);
+    if (it != sCache.end() && it->second.size == st.st_size &&
+        it->second.mtime.tv_sec == st.st_mtim.tv_sec &&
+        it->second.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+      ::close(fd);
+      table = it->second.table;
+      return kSuccess;
+    }
+  }
+
+  void *map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ErrorCode error = (map == MAP_FAILED) ? Platform::TranslateError() : kSuccess;
+  ::close(fd);
+  if (error != kSuccess)
+    return error;
+
+  auto image = static_cast<uint8_t const *>(map);
+  if (std::memcmp(image, ELFMAG, SELFMAG) != 0) {
+    ::munmap(map, st.st_size);
+    return kErrorInvalidArgument;
+  }
+
+  auto newTable = std::make_shared<ELFSymbolTable>();
+  switch (image[EI_CLASS]) {
+  case ELFCLASS32:
+    newTable->load<Elf32_Ehdr, Elf32_Phdr, Elf32_Shdr, Elf32_Sym>(image,
+                                                                  st.st_size);
+    break;
+  case ELFCLASS64:
+    newTable->load<Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr, Elf64_Sym>(image,
+                                                                  st.st_size);
+    break;
+  default:
+    break;
+  }
+  ::munmap(map, st.st_size);
+
+  DS2LOG(Debug, "%s: %zu symbols", path.c_str(), newTable->count());
+
+  CacheEntry entry;
+  entry.size = st.st_size;
+  entry.mtime = st.st_mtim;
+  entry.table = newTable;
+
+  {
+    std::lock_guard<std::mutex> guard(sCacheLock);
+    sCache[key] = entry;
+  }
+
+  table = newTable;
+  return kSuccess;
+}
+} // namespace Support
+} // namespace ds2
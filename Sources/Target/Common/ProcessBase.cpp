@@ -45,6 +45,19 @@ ErrorCode ProcessBase::getInfo(ProcessInfo &info) {
   return error;
 }
 
+ErrorCode ProcessBase::getInfo(ProcessInfo const *&info) {
+  ErrorCode error = updateInfo();
+  if (error != kSuccess && error != kErrorAlreadyExist) {
+    return error;
+  }
+  info = &_info;
+  return kSuccess;
+}
+
+ErrorCode ProcessBase::getCurrentInfo(ProcessInfo &info) {
+  return getInfo(info);
+}
+
 // This is a utility function for detach.
 void ProcessBase::cleanup() {
   std::set<Thread *> threads;
@@ -144,13 +157,8 @@ ErrorCode ProcessBase::resume(int signal, std::set<Thread *> const &excluded) {
 
     case Thread::kStopped:
     case Thread::kStepped: {
-      Architecture::CPUState state;
-      thread->readCPUState(state);
-      DS2LOG(Debug,
-             "resuming tid %" PRI_PID " in state %s from pc %" PRI_PTR
-             " with signal %d",
-             thread->tid(), Stringify::ThreadState(thread->state()),
-             PRI_PTR_CAST(state.pc()), signal);
+      DS2LOG(Debug, "resuming tid %" PRI_PID " in state %s with signal %d",
+             thread->tid(), Stringify::ThreadState(thread->state()), signal);
       ErrorCode error = thread->resume(signal);
       if (error != kSuccess) {
         DS2LOG(Warning, "failed resuming tid %" PRI_PID ", error=%s",
@@ -190,6 +198,16 @@ void ProcessBase::getThreadIds(std::vector<ThreadId> &tids) {
   }
 }
 
+void ProcessBase::getThreadIds(ThreadId lastTid, size_t count,
+                               std::vector<ThreadId> &tids) const {
+  tids.clear();
+  auto it = (lastTid == kAllThreadId) ? _threads.begin()
+                                      : _threads.upper_bound(lastTid);
+  for (; it != _threads.end() && tids.size() < count; ++it) {
+    tids.push_back(it->first);
+  }
+}
+
 ds2::Target::Thread *ProcessBase::thread(ThreadId tid) const {
   auto it = _threads.find(tid);
   return (it == _threads.end()) ? nullptr : it->second;
@@ -304,10 +322,18 @@ ErrorCode ProcessBase::afterResume() {
     return kSuccess;
   }
 
-  // Disable breakpoints and try to hit software breakpoints.
+  // Disable breakpoints and try to hit software breakpoints. Only threads
+  // that stopped on a trap can be sitting on one of our breakpoints; the
+  // others were just suspended and there is no need to look at their
+  // registers.
   BreakpointManager *swBpm = softwareBreakpointManager();
   if (swBpm != nullptr) {
     for (auto it : _threads) {
+      StopInfo const &stopInfo = it.second->stopInfo();
+      if (stopInfo.event != StopInfo::kEventStop ||
+          stopInfo.reason != StopInfo::kReasonBreakpoint)
+        continue;
+
       BreakpointManager::Site site;
       if (swBpm->hit(it.second, site) >= 0) {
         DS2LOG(Debug, "hit breakpoint for tid %" PRI_PID, it.second->tid());
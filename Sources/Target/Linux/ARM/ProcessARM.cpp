@@ -206,6 +206,19 @@ static void ThumbPrepareMunmapCode(uint32_t address, size_t size,
 #endif
 }
 
+static uint16_t const gThumbForkCode[] = {
+    0x2700, // 00[00]: movs   r7, #XX
+    0xdf00, // 02[01]: svc    0
+    0xde01, // 04[02]: udf    #1
+};
+
+static void ThumbPrepareForkCode(ByteVector &codestr) {
+  InitCodeVector(codestr, gThumbForkCode);
+
+  uint16_t *code = reinterpret_cast<uint16_t *>(&codestr[0]);
+  T1MOV8SetImmediate(code + 0x00, __NR_fork);
+}
+
 //
 // ARM code
 //
@@ -254,6 +267,19 @@ static void ARMPrepareMunmapCode(uint32_t address, size_t size,
   code[0x05] = address;
   code[0x06] = size;
 }
+
+static uint32_t const gARMForkCode[] = {
+    0xe3b07000, // 00[00]: movs   r7, #XX
+    0xef000000, // 04[01]: svc    0
+    0xe7f001f0, // 08[02]: udf    #16
+};
+
+static void ARMPrepareForkCode(ByteVector &codestr) {
+  InitCodeVector(codestr, gARMForkCode);
+
+  uint32_t *code = reinterpret_cast<uint32_t *>(&codestr[0]);
+  ARMMOV8SetImmediate(code + 0x00, __NR_fork);
+}
 } // namespace
 
 ErrorCode Process::allocateMemory(size_t size, uint32_t protection,
@@ -322,6 +348,7 @@ ErrorCode Process::deallocateMemory(uint64_t address, size_t size) {
   // Code inject and execute
   //
   uint64_t result = 0;
+  invalidateReadAhead();
   CHK(ptrace().execute(_currentThread->tid(), info, &codestr[0], codestr.size(),
                        result));
 
@@ -334,6 +361,22 @@ ErrorCode Process::deallocateMemory(uint64_t address, size_t size) {
   return kSuccess;
 }
 
+ErrorCode Process::prepareForkCode(ByteVector &codestr) {
+  ProcessInfo info;
+  CHK(getInfo(info));
+
+  Architecture::CPUState state;
+  CHK(ptrace().readCPUState(_currentThread->tid(), info, state));
+
+  if (state.isThumb()) {
+    ThumbPrepareForkCode(codestr);
+  } else {
+    ARMPrepareForkCode(codestr);
+  }
+
+  return kSuccess;
+}
+
 int Process::getMaxBreakpoints() const {
   return ptrace().getMaxHardwareBreakpoints(_pid);
 }
@@ -56,6 +56,16 @@ ErrorCode Process::allocateMemory(size_t size, uint32_t protection,
 ErrorCode Process::deallocateMemory(uint64_t address, size_t size) {
   return kErrorUnsupported;
 }
+
+ErrorCode Process::prepareForkCode(ByteVector &codestr) {
+  // We don't support ARM on ARM64 yet.
+  if (is32BitProcess(this)) {
+    return kErrorUnsupported;
+  }
+
+  ARM64Sys::PrepareForkCode(codestr);
+  return kSuccess;
+}
 } // namespace Linux
 } // namespace Target
 } // namespace ds2
@@ -11,21 +11,26 @@
 #define __DS2_LOG_CLASS_NAME__ "Target::Process"
 
 #include "DebugServer2/Target/Process.h"
-#include "DebugServer2/Core/BreakpointManager.h"
+#include "DebugServer2/Core/HardwareBreakpointManager.h"
+#include "DebugServer2/Core/SoftwareBreakpointManager.h"
 #include "DebugServer2/Host/Linux/ExtraWrappers.h"
 #include "DebugServer2/Host/Linux/PTrace.h"
 #include "DebugServer2/Host/Linux/ProcFS.h"
+#include "DebugServer2/Host/Linux/TracerPool.h"
 #include "DebugServer2/Host/Platform.h"
 #include "DebugServer2/Target/Thread.h"
 #include "DebugServer2/Utils/Log.h"
 #include "DebugServer2/Utils/String.h"
 #include "DebugServer2/Utils/Stringify.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <csignal>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <elf.h>
+#include <fcntl.h>
 #include <limits>
 #include <sys/ptrace.h>
 #include <sys/wait.h>
@@ -37,6 +42,7 @@
 using ds2::Host::Platform;
 using ds2::Host::Linux::ProcFS;
 using ds2::Host::Linux::PTrace;
+using ds2::Host::Linux::TracerPool;
 using ds2::Utils::Stringify;
 
 #define super ds2::Target::POSIX::ELFProcess
@@ -45,12 +51,63 @@ namespace ds2 {
 namespace Target {
 namespace Linux {
 
+// Bounds of the read-ahead window, which doubles each time a pattern of
+// reads goes past it.
+static size_t const kMinReadAhead = 4 * 1024;
+static size_t const kMaxReadAhead = 64 * 1024;
+// Number of reads following a pattern before we start reading ahead.
+static size_t const kReadAheadStreak = 2;
+
+Process::Process()
+    : _reportedEvents(0), _detachOnFork(true), _vforkPending(false),
+      _trackDirtyPages(false), _memFd(-1), _procFSOpens(0) {
+  _readAhead.start = 0;
+  _readAhead.lastAddress = _readAhead.lastEnd = 0;
+  _readAhead.stride = 0;
+  _readAhead.streak = 0;
+  _readAhead.size = kMinReadAhead;
+}
+
+std::map<ProcessId, Process *> Process::sProcesses;
+
+Process::~Process() {
+  auto it = sProcesses.find(_pid);
+  if (it != sProcesses.end() && it->second == this) {
+    sProcesses.erase(it);
+  }
+
+  if (_memFd >= 0) {
+    ::close(_memFd);
+  }
+}
+
 ErrorCode Process::attach(int waitStatus) {
+  //
+  // A task that was already stopped, e.g.: by onAttach when it waits for a
+  // process to exec, first reports that group-stop, which has no siginfo.
+  // The SIGSTOP sent by PTRACE_ATTACH is still pending behind it; let it be
+  // delivered so that we report the usual attach stop, and the process does
+  // not stop again for it once resumed.
+  //
+  auto skipGroupStop = [this](pid_t tid, int &status) -> ErrorCode {
+    siginfo_t si;
+    if (!WIFSTOPPED(status) || WSTOPSIG(status) != SIGSTOP ||
+        ptrace().getSigInfo(tid, si) != kErrorInvalidArgument)
+      return kSuccess;
+
+    DS2LOG(Debug, "tid %" PRI_PID " was already stopped", tid);
+    CHK(ptrace().resume(tid, ProcessInfo()));
+    return ptrace().wait(tid, &status);
+  };
+
+  sProcesses[_pid] = this;
+
   if (waitStatus <= 0) {
     CHK(ptrace().attach(_pid));
     _flags |= kFlagAttachedProcess;
     CHK(ptrace().wait(_pid, &waitStatus));
     ptrace().traceThat(_pid);
+    CHK(skipGroupStop(_pid, waitStatus));
   }
 
   if (_flags & kFlagAttachedProcess) {
@@ -81,6 +138,7 @@ ErrorCode Process::attach(int waitStatus) {
           int status;
           ptrace().wait(tid, &status);
           ptrace().traceThat(tid);
+          skipGroupStop(tid, status);
           thread->updateStopInfo(status);
         }
       });
@@ -105,9 +163,103 @@ static pid_t blocking_waitpid(pid_t pid, int *status, int flags) {
   return ret;
 }
 
+//
+// Returns the process a status we reaped is for: the one `tid` is a thread
+// of, or, for the initial stop of a child that was just forked, its parent
+// (`forkedChild` is set then). Returns nullptr if we don't know.
+//
+Process *Process::FindOwner(pid_t tid, int status, bool &forkedChild) {
+  forkedChild = false;
+  for (auto const &it : sProcesses) {
+    if (it.second->_threads.find(tid) != it.second->_threads.end())
+      return it.second;
+  }
+
+  // Threads that are gone can't be looked up.
+  if (WIFEXITED(status) || WIFSIGNALED(status))
+    return nullptr;
+
+  ProcFS::Stat stat;
+  for (auto const &it : sProcesses) {
+    if (ProcFS::ReadStat(it.first, tid, stat))
+      return it.second;
+  }
+
+  if (!ProcFS::ReadStat(tid, stat))
+    return nullptr;
+
+  auto it = sProcesses.find(stat.ppid);
+  if (it == sProcesses.end())
+    return nullptr;
+
+  forkedChild = true;
+  return it->second;
+}
+
+#if defined(HAVE_PROCESS_VM_READV)
+//
+// Debuggers disassemble, dump memory and walk structures with many small
+// reads at increasing addresses. Once a few reads follow each other, or are
+// the same distance apart, fetch a larger window at once and serve the
+// following reads from it.
+//
+bool Process::readAhead(uint64_t address, void *data, size_t length) {
+  auto &ra = _readAhead;
+
+  auto stride = static_cast<int64_t>(address - ra.lastAddress);
+  bool predicted =
+      (address == ra.lastEnd) ||
+      (stride > 0 && stride == ra.stride &&
+       static_cast<size_t>(stride) <= kMaxReadAhead / 4);
+  if (predicted) {
+    ra.streak++;
+  } else {
+    ra.streak = 0;
+    ra.size = kMinReadAhead;
+  }
+  ra.stride = stride;
+  ra.lastAddress = address;
+  ra.lastEnd = address + length;
+
+  if (address < ra.start || address + length > ra.start + ra.data.size()) {
+    if (ra.streak < kReadAheadStreak || length >= ra.size)
+      return false;
+
+    ra.data.resize(ra.size);
+    struct iovec local_iov = {ra.data.data(), ra.data.size()};
+    struct iovec remote_iov = {reinterpret_cast<void *>(address),
+                               ra.data.size()};
+    auto id = _currentThread == nullptr ? _pid : _currentThread->tid();
+
+    // This stops short at the first page that can't be read.
+    ssize_t ret = process_vm_readv(id, &local_iov, 1, &remote_iov, 1, 0);
+    if (ret < static_cast<ssize_t>(length)) {
+      invalidateReadAhead();
+      return false;
+    }
+
+    ra.start = address;
+    ra.data.resize(ret);
+    ra.size = std::min(ra.size * 2, kMaxReadAhead);
+  }
+
+  std::memcpy(data, &ra.data[address - ra.start], length);
+  return true;
+}
+#endif
+
+void Process::invalidateReadAhead() { _readAhead.data.clear(); }
+
 ErrorCode Process::readMemory(Address const &address, void *data, size_t length,
                               size_t *count) {
 #if defined(HAVE_PROCESS_VM_READV)
+  if (readAhead(address.value(), data, length)) {
+    if (count != nullptr) {
+      *count = length;
+    }
+    return kSuccess;
+  }
+
   // Using process_vm_readv() is faster than using ptrace() because we can do
   // bigger reads that ptrace() (which can only read a word at a time); the
   // drawback is that process_vm_readv() cannot bypass page-level permissions
@@ -136,8 +288,39 @@ ErrorCode Process::readMemory(Address const &address, void *data, size_t length,
   return super::readMemory(address, data, length, count);
 }
 
+//
+// Writes to /proc/<pid>/mem go through page protections like ptrace(2) does,
+// so that code can be patched, but take any length in a single call, where
+// ptrace(2) takes one per word.
+//
+bool Process::writeMemFile(uint64_t address, void const *data, size_t length) {
+  if (_memFd == -1) {
+    _memFd = ProcFS::OpenFd(_pid, "mem", O_RDWR | O_CLOEXEC);
+    if (_memFd < 0) {
+      DS2LOG(Debug, "cannot open memory of pid %" PRI_PID ": %s", _pid,
+             Stringify::Errno(errno));
+      _memFd = -2;
+    }
+  }
+
+  if (_memFd < 0)
+    return false;
+
+  return ::pwrite64(_memFd, data, length, address) ==
+         static_cast<ssize_t>(length);
+}
+
 ErrorCode Process::writeMemory(Address const &address, void const *data,
                                size_t length, size_t *count) {
+  invalidateReadAhead();
+
+  if (writeMemFile(address.value(), data, length)) {
+    if (count != nullptr) {
+      *count = length;
+    }
+    return kSuccess;
+  }
+
 #if defined(HAVE_PROCESS_VM_WRITEV)
   // See comment in Process::readMemory.
   if (length > sizeof(uintptr_t)) {
@@ -183,9 +366,15 @@ ErrorCode Process::wait() {
   DS2ASSERT(!_threads.empty());
 
   while (!_threads.empty()) {
-    tid = blocking_waitpid(-1, &status, __WALL);
-    if (tid <= 0) {
-      return kErrorProcessNotFound;
+    if (!_strayStatuses.empty()) {
+      tid = _strayStatuses.front().first;
+      status = _strayStatuses.front().second;
+      _strayStatuses.pop_front();
+    } else {
+      tid = blocking_waitpid(-1, &status, __WALL);
+      if (tid <= 0) {
+        return kErrorProcessNotFound;
+      }
     }
 
     DS2LOG(Debug, "tid %" PRI_PID " %s", tid, Stringify::WaitStatus(status));
@@ -193,6 +382,21 @@ ErrorCode Process::wait() {
     auto threadIt = _threads.find(tid);
 
     if (threadIt == _threads.end()) {
+      // Statuses of the other processes we trace, e.g.: inferiors kept after
+      // a fork or checkpoints, are left for their own wait().
+      bool forkedChild;
+      Process *owner = FindOwner(tid, status, forkedChild);
+      if (owner != nullptr && owner != this) {
+        DS2LOG(Debug, "tid %" PRI_PID " belongs to pid %" PRI_PID, tid,
+               owner->_pid);
+        if (forkedChild) {
+          owner->_forkedChildren[tid] = status;
+        } else {
+          owner->_strayStatuses.push_back(std::make_pair(tid, status));
+        }
+        goto continue_waiting;
+      }
+
       // If we don't know about this thread yet, but it has a WIFEXITED() or a
       // WIFSIGNALED() status (i.e.: it terminated), it means we already
       // cleaned up the thread object (e.g.: in Process::suspend), but we
@@ -201,6 +405,16 @@ ErrorCode Process::wait() {
         goto continue_waiting;
       }
 
+      // If it isn't one of our threads, it's a child we forked and we got its
+      // initial stop before the fork event of its parent. Keep it around for
+      // handleFork().
+      ProcFS::Stat stat;
+      if (!ProcFS::ReadStat(_pid, tid, stat)) {
+        DS2LOG(Debug, "tid %" PRI_PID " is a forked child", tid);
+        _forkedChildren[tid] = status;
+        goto continue_waiting;
+      }
+
       // A new thread has appeared that we didn't know about. Create the
       // Thread object and return.
       DS2LOG(Debug, "creating new thread tid=%d", tid);
@@ -251,6 +465,38 @@ ErrorCode Process::wait() {
       goto continue_waiting;
 
     case StopInfo::kEventStop:
+      switch (_currentThread->_stopInfo.reason) {
+      case StopInfo::kReasonFork:
+      case StopInfo::kReasonVFork:
+        if (!handleFork(_currentThread->_stopInfo)) {
+          _currentThread->resume();
+          goto continue_waiting;
+        }
+        break;
+
+      case StopInfo::kReasonVForkDone:
+        // The child doesn't use our address space anymore, see handleFork.
+        _vforkPending = false;
+        restoreVForkTraps();
+        if (!(_reportedEvents & kReportVFork)) {
+          _currentThread->resume();
+          goto continue_waiting;
+        }
+        break;
+
+      case StopInfo::kReasonExec:
+        handleExec();
+        if (!(_reportedEvents & kReportExec)) {
+          // GDB clients that didn't ask for exec events still need to stop
+          // here to reload the new image.
+          _currentThread->_stopInfo.reason = StopInfo::kReasonTrap;
+        }
+        break;
+
+      default:
+        break;
+      }
+
       signal = _currentThread->_stopInfo.signal;
 
       DS2LOG(Debug, "stopped tid=%" PRI_PID " status=%#x signal=%s", tid,
@@ -289,9 +535,308 @@ ErrorCode Process::wait() {
     _terminated = true;
   }
 
+  uint64_t procFSOpens = ProcFS::OpenCount();
+  DS2LOG(Debug, "%" PRIu64 " files opened in /proc since the last stop",
+         procFSOpens - _procFSOpens);
+  _procFSOpens = procFSOpens;
+
   return kSuccess;
 }
 
+//
+// Collects the initial stop of the child we were just told about, and decides
+// what to do with it. Returns true if the fork has to be reported to the
+// debugger.
+//
+bool Process::handleFork(StopInfo const &stopInfo) {
+  ProcessId childPid = stopInfo.childPid;
+  bool vfork = (stopInfo.reason == StopInfo::kReasonVFork);
+
+  auto it = _forkedChildren.find(childPid);
+  if (it == _forkedChildren.end()) {
+    int status;
+    if (blocking_waitpid(childPid, &status, __WALL) != childPid) {
+      DS2LOG(Warning, "unable to wait for forked child %" PRI_PID ", error=%s",
+             childPid, Stringify::Errno(errno));
+      return false;
+    }
+    it = _forkedChildren.insert(std::make_pair(childPid, status)).first;
+  }
+
+  DS2LOG(Debug, "tid %" PRI_PID " %s child %" PRI_PID, _currentThread->tid(),
+         vfork ? "vforked" : "forked", childPid);
+
+  // The child got a copy of our address space with the breakpoints that are
+  // currently inserted; put back the original instructions so it doesn't trap
+  // on them once we let it go. A vfork child shares our address space instead:
+  // the breakpoints are taken out of it until the vforkdone event, which is
+  // when the child execs or exits.
+  if (vfork) {
+    _vforkPending = true;
+    removeVForkTraps();
+  } else if (_softwareBreakpointManager != nullptr) {
+    _softwareBreakpointManager->enumerateSavedInstructions(
+        [&](Address const &address, ByteVector const &insn) {
+          _ptrace.writeMemory(childPid, address, insn.data(), insn.size());
+        });
+  }
+
+  if (_reportedEvents & (vfork ? kReportVFork : kReportFork)) {
+    return true;
+  }
+
+  // A vfork parent doesn't run until its child execs or exits, so we can't
+  // keep the child stopped when the debugger doesn't know about it.
+  if (_detachOnFork || vfork) {
+    _ptrace.detach(childPid);
+    _forkedChildren.erase(it);
+  }
+
+  return false;
+}
+
+//
+// Puts the original instructions back where breakpoints are inserted, and
+// remembers the traps to reinsert them once the vfork child is gone.
+//
+void Process::removeVForkTraps() {
+  if (_softwareBreakpointManager == nullptr)
+    return;
+
+  _softwareBreakpointManager->enumerateSavedInstructions(
+      [&](Address const &address, ByteVector const &insn) {
+        ByteVector trap(insn.size());
+        if (readMemory(address, trap.data(), trap.size()) != kSuccess ||
+            writeMemory(address, insn.data(), insn.size()) != kSuccess) {
+          DS2LOG(Warning, "unable to remove breakpoint at %" PRI_PTR,
+                 PRI_PTR_CAST(address.value()));
+          return;
+        }
+        _vforkTraps[address.value()] = std::move(trap);
+      });
+}
+
+void Process::restoreVForkTraps() {
+  for (auto const &trap : _vforkTraps) {
+    if (writeMemory(trap.first, trap.second.data(), trap.second.size()) !=
+        kSuccess) {
+      DS2LOG(Warning, "unable to reinsert breakpoint at %" PRI_PTR,
+             PRI_PTR_CAST(trap.first));
+    }
+  }
+  _vforkTraps.clear();
+}
+
+//
+// execve(2) destroyed every other thread and replaced the address space, so
+// everything we knew about either is stale now.
+//
+void Process::handleExec() {
+  for (auto it = _threads.begin(); it != _threads.end();) {
+    ThreadId tid = (it++)->first;
+    if (tid != _pid) {
+      removeThread(tid);
+    }
+  }
+
+  if (_softwareBreakpointManager != nullptr) {
+    _softwareBreakpointManager->clear();
+  }
+  if (_hardwareBreakpointManager != nullptr) {
+    _hardwareBreakpointManager->clear();
+  }
+
+  // The file still refers to the address space from before the exec.
+  if (_memFd >= 0) {
+    ::close(_memFd);
+  }
+  _memFd = -1;
+
+  _info.clear();
+  _auxiliaryVector.clear();
+  _loadBase = Address();
+  _entryPoint = Address();
+  _sharedLibraryInfoAddress = Address();
+
+  updateInfo();
+}
+
+ds2::Target::Process *Process::adoptForkedChild() {
+  if (_forkedChildren.empty()) {
+    return nullptr;
+  }
+
+  ProcessId childPid = _forkedChildren.begin()->first;
+  int status = _forkedChildren.begin()->second;
+  _forkedChildren.erase(_forkedChildren.begin());
+
+  return adoptChild(childPid, status);
+}
+
+// Creates the Process object for a child that is stopped and traced with our
+// options, given the status of its initial stop.
+ds2::Target::Process *Process::adoptChild(ProcessId childPid, int status) {
+  auto child = ds2::make_unique<Process>();
+  child->_passthruSignals = _passthruSignals;
+  child->_reportedEvents = _reportedEvents;
+  child->_detachOnFork = _detachOnFork;
+
+  // The child is already stopped and traced with our options, so we skip
+  // POSIX::Process::initialize which would wait for it.
+  if (child->ProcessBase::initialize(childPid, kFlagAttachedProcess) !=
+          kSuccess ||
+      child->attach(status) != kSuccess) {
+    DS2LOG(Warning, "unable to adopt forked child %" PRI_PID, childPid);
+    _ptrace.detach(childPid);
+    return nullptr;
+  }
+
+  return child.release();
+}
+
+//
+// The current thread is made to fork(2); the child only has a copy of that
+// thread, stopped where the fork returned, and a copy of the code we injected
+// to do it. Both are put back as they were in the parent before the child is
+// parked.
+//
+ErrorCode Process::checkpoint(ds2::Target::Process *&snapshot) {
+  ProcessInfo info;
+  CHK(getInfo(info));
+
+  ThreadId tid = _currentThread->tid();
+  Architecture::CPUState state;
+  CHK(_ptrace.readCPUState(tid, info, state));
+
+  ByteVector codestr;
+  CHK(prepareForkCode(codestr));
+
+  uint64_t result;
+  CHK(executeCode(codestr, result));
+
+  auto childPid = static_cast<int32_t>(result);
+  if (childPid <= 0) {
+    DS2LOG(Debug, "fork failed with errno=%s", Stringify::Errno(-childPid));
+    return childPid < 0 ? Platform::TranslateError(-childPid) : kErrorUnknown;
+  }
+
+  int status;
+  if (blocking_waitpid(childPid, &status, __WALL) != childPid) {
+    DS2LOG(Warning, "unable to wait for checkpoint %" PRI_PID ", error=%s",
+           childPid, Stringify::Errno(errno));
+    return Platform::TranslateError();
+  }
+
+  ByteVector savedCode(codestr.size());
+  ErrorCode error =
+      _ptrace.readMemory(tid, state.pc(), savedCode.data(), savedCode.size());
+  if (error == kSuccess) {
+    error = _ptrace.writeMemory(childPid, state.pc(), savedCode.data(),
+                                savedCode.size());
+  }
+  if (error == kSuccess) {
+    error = _ptrace.writeCPUState(childPid, info, state);
+  }
+  if (error == kSuccess) {
+    snapshot = adoptChild(childPid, status);
+    if (snapshot != nullptr) {
+      DS2LOG(Debug, "pid %" PRI_PID " checkpointed as pid %" PRI_PID, _pid,
+             childPid);
+      return kSuccess;
+    }
+    return kErrorUnknown;
+  }
+
+  _ptrace.kill(childPid, SIGKILL);
+  blocking_waitpid(childPid, &status, __WALL);
+  return error;
+}
+
+//
+// With a tracer pool, every running thread is sent a SIGSTOP first, and the
+// stops are then collected by the tracer threads in parallel. Otherwise, see
+// ProcessBase::suspend, which waits for each thread before stopping the next.
+//
+ErrorCode Process::suspend() {
+  TracerPool *pool = TracerPool::Get();
+  if (pool == nullptr) {
+    return super::suspend();
+  }
+
+  struct Suspended {
+    Thread *thread;
+    ErrorCode error;
+  };
+  std::map<pid_t, Suspended> suspended;
+  std::vector<pid_t> tids;
+  std::vector<ThreadId> dead;
+
+  enumerateThreads([&](Thread *thread) {
+    switch (thread->state()) {
+    case Thread::kInvalid:
+      DS2BUG("trying to suspend tid %" PRI_PID " in state %s", thread->tid(),
+             Stringify::ThreadState(thread->state()));
+      break;
+
+    case Thread::kTerminated:
+      dead.push_back(thread->tid());
+      break;
+
+    case Thread::kRunning:
+      if (ptrace().suspend(ProcessThreadId(_pid, thread->tid())) != kSuccess) {
+        dead.push_back(thread->tid());
+        break;
+      }
+      suspended[thread->tid()] = {thread, kSuccess};
+      tids.push_back(thread->tid());
+      break;
+
+    default:
+      break;
+    }
+  });
+
+  // Threads may look at the breakpoint managers while their stop info gets
+  // updated; create them now rather than concurrently.
+  softwareBreakpointManager();
+  hardwareBreakpointManager();
+
+  pool->runGrouped(tids, [&](pid_t tid) {
+    Suspended &entry = suspended.find(tid)->second;
+
+    int status;
+    entry.error = ptrace().wait(ProcessThreadId(_pid, tid), &status);
+    if (entry.error == kSuccess) {
+      entry.thread->updateStopInfo(status);
+    }
+  });
+
+  ErrorCode error = kSuccess;
+  for (auto const &it : suspended) {
+    if (it.second.error != kSuccess ||
+        it.second.thread->state() == Thread::kTerminated) {
+      dead.push_back(it.first);
+    }
+  }
+
+  for (ThreadId tid : dead) {
+    DS2LOG(Debug, "tid %" PRI_PID " is already dead", tid);
+    removeThread(tid);
+    error = kErrorProcessNotFound;
+  }
+
+  return error;
+}
+
+void Process::removeThread(ThreadId tid) {
+  TracerPool *pool = TracerPool::Get();
+  if (pool != nullptr) {
+    pool->forget(tid);
+  }
+
+  super::removeThread(tid);
+}
+
 ErrorCode Process::terminate() {
   ErrorCode error = super::terminate();
   if (error == kSuccess || error == kErrorProcessNotFound) {
@@ -359,6 +904,13 @@ ErrorCode Process::updateAuxiliaryVector() {
 }
 
 ErrorCode Process::updateInfo() {
+  // What register accesses need doesn't change until the process execs, and
+  // handleExec clears it; don't go back to /proc each time. The ids can
+  // change, getCurrentInfo reads them again.
+  if (_info.pid == _pid) {
+    return kErrorAlreadyExist;
+  }
+
   //
   // Some info like parent pid, OS vendor, etc is obtained via /proc.
   //
@@ -375,6 +927,166 @@ ErrorCode Process::updateInfo() {
   return kSuccess;
 }
 
+ErrorCode Process::getCurrentInfo(ProcessInfo &info) {
+  CHK(getInfo(info));
+
+  pid_t ppid;
+  uid_t uid, euid;
+  gid_t gid, egid;
+  if (!ProcFS::ReadProcessIds(_pid, ppid, uid, euid, gid, egid))
+    return kErrorProcessNotFound;
+
+  _info.parentPid = info.parentPid = ppid;
+  _info.realUid = info.realUid = uid;
+  _info.effectiveUid = info.effectiveUid = euid;
+  _info.realGid = info.realGid = gid;
+  _info.effectiveGid = info.effectiveGid = egid;
+  return kSuccess;
+}
+
+//
+// Dirty pages are found with the soft-dirty bits of the page table entries:
+// they are cleared through /proc/pid/clear_refs when the process is resumed,
+// and the ones set again when it stops are read from /proc/pid/pagemap.
+//
+ErrorCode Process::enableDirtyPageTracking(bool enable) {
+  if (enable && !_trackDirtyPages) {
+    // Fails on kernels without CONFIG_MEM_SOFT_DIRTY.
+    CHK(clearSoftDirtyBits());
+  }
+
+  _trackDirtyPages = enable;
+  _dirtyRanges.clear();
+  return kSuccess;
+}
+
+ErrorCode
+Process::getDirtyMemoryRanges(MemoryRange::Collection &ranges) const {
+  if (!_trackDirtyPages)
+    return kErrorInvalidArgument;
+
+  ranges = _dirtyRanges;
+  return kSuccess;
+}
+
+ErrorCode Process::beforeResume() {
+  invalidateReadAhead();
+  CHK(super::beforeResume());
+
+  if (_vforkPending) {
+    removeVForkTraps();
+  }
+
+  // Breakpoints were just inserted; clearing the bits now keeps the pages
+  // they're on from showing up as dirty.
+  if (_trackDirtyPages) {
+    CHK(clearSoftDirtyBits());
+  }
+
+  return kSuccess;
+}
+
+ErrorCode Process::afterResume() {
+  invalidateReadAhead();
+
+  // This has to be done before breakpoints are removed, for the same reason.
+  if (_trackDirtyPages && isAlive()) {
+    ErrorCode error = collectDirtyPages();
+    if (error != kSuccess) {
+      DS2LOG(Warning, "unable to read dirty pages of pid %" PRI_PID ": %s",
+             _pid, Stringify::Error(error));
+    }
+  }
+
+  // Removing the breakpoints puts back the original instructions anyway.
+  _vforkTraps.clear();
+
+  return super::afterResume();
+}
+
+ErrorCode Process::clearSoftDirtyBits() {
+  int fd = ProcFS::OpenFd(_pid, "clear_refs", O_WRONLY);
+  if (fd < 0)
+    return Platform::TranslateError();
+
+  // 4 clears the soft-dirty bits only.
+  ErrorCode error = kSuccess;
+  if (::write(fd, "4", 1) != 1) {
+    error = Platform::TranslateError();
+  }
+
+  ::close(fd);
+  return error;
+}
+
+ErrorCode Process::collectDirtyPages() {
+  static uint64_t const kPageMapSoftDirty = 1ULL << 55;
+  static size_t const kPageMapChunk = 64 * 1024;
+
+  _dirtyRanges.clear();
+
+  FILE *fp = ProcFS::OpenFILE(_pid, "maps");
+  if (fp == nullptr)
+    return Platform::TranslateError();
+
+  // Only writable mappings can have pages written to.
+  std::vector<std::pair<uint64_t, uint64_t>> mappings;
+  char buf[PATH_MAX * 2];
+  while (std::fgets(buf, sizeof(buf), fp) != nullptr) {
+    uint64_t start, end;
+    char perms[5];
+    if (std::sscanf(buf, "%" SCNx64 "-%" SCNx64 " %4s", &start, &end,
+                    perms) != 3)
+      continue;
+    if (perms[1] != 'w' || std::strstr(buf, "[vvar]") != nullptr)
+      continue;
+    mappings.emplace_back(start, end);
+  }
+  std::fclose(fp);
+
+  int fd = ProcFS::OpenFd(_pid, "pagemap");
+  if (fd < 0)
+    return Platform::TranslateError();
+
+  uint64_t pageSize = Platform::GetPageSize();
+  std::vector<uint64_t> entries(kPageMapChunk);
+  ErrorCode error = kSuccess;
+
+  for (auto const &mapping : mappings) {
+    for (uint64_t address = mapping.first;
+         address < mapping.second && error == kSuccess;) {
+      size_t count = std::min<uint64_t>(kPageMapChunk,
+                                        (mapping.second - address) / pageSize);
+      ssize_t nread =
+          ::pread64(fd, entries.data(), count * sizeof(uint64_t),
+                    (address / pageSize) * sizeof(uint64_t));
+      if (nread <= 0) {
+        if (nread < 0 && errno == EINTR)
+          continue;
+        error = (nread < 0) ? Platform::TranslateError() : kErrorUnknown;
+        break;
+      }
+
+      count = nread / sizeof(uint64_t);
+      for (size_t n = 0; n < count; n++, address += pageSize) {
+        if (!(entries[n] & kPageMapSoftDirty))
+          continue;
+
+        if (!_dirtyRanges.empty() &&
+            _dirtyRanges.back().start + _dirtyRanges.back().length ==
+                address) {
+          _dirtyRanges.back().length += pageSize;
+        } else {
+          _dirtyRanges.push_back({address, pageSize});
+        }
+      }
+    }
+  }
+
+  ::close(fd);
+  return error;
+}
+
 ErrorCode Process::getMemoryRegionInfo(Address const &address,
                                        MemoryRegionInfo &info) {
   if (!address.valid()) {
@@ -477,11 +1189,12 @@ ErrorCode Process::getMemoryRegionInfo(Address const &address,
 }
 
 ErrorCode Process::executeCode(ByteVector const &codestr, uint64_t &result) {
-  ProcessInfo info;
+  ProcessInfo const *info;
 
   CHK(getInfo(info));
-  CHK(ptrace().execute(_currentThread->tid(), info, &codestr[0], codestr.size(),
-                       result));
+  invalidateReadAhead();
+  CHK(ptrace().execute(_currentThread->tid(), *info, &codestr[0],
+                       codestr.size(), result));
 
   return kSuccess;
 }
@@ -0,0 +1,503 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#define __DS2_LOG_CLASS_NAME__ "Target::Process"
+
+#include "DebugServer2/Target/Process.h"
+#include "DebugServer2/Host/Linux/PTrace.h"
+#include "DebugServer2/Host/Linux/ProcFS.h"
+#include "DebugServer2/Host/Platform.h"
+#include "DebugServer2/Target/Thread.h"
+#include "DebugServer2/Utils/Log.h"
+#include "DebugServer2/Utils/Stringify.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <linux/posix_types.h>
+#include <unistd.h>
+#include <vector>
+
+using ds2::Host::Platform;
+using ds2::Host::Linux::ProcFS;
+using ds2::Utils::Stringify;
+
+#if !defined(NT_FILE)
+#define NT_FILE 0x46494c45
+#endif
+#if !defined(NT_X86_XSTATE)
+#define NT_X86_XSTATE 0x202
+#endif
+#if !defined(NT_ARM_VFP)
+#define NT_ARM_VFP 0x400
+#endif
+#if !defined(PN_XNUM)
+#define PN_XNUM 0xffff
+#endif
+
+namespace ds2 {
+namespace Target {
+namespace Linux {
+
+namespace {
+
+// We only write cores for processes of our own word size, which lets us use
+// the native layout of the kernel structures below.
+#if defined(ARCH_X86_64) || defined(ARCH_ARM64)
+typedef Elf64_Ehdr CoreEhdr;
+typedef Elf64_Phdr CorePhdr;
+typedef Elf64_Shdr CoreShdr;
+typedef Elf64_Nhdr CoreNhdr;
+static uint8_t const kCoreClass = ELFCLASS64;
+#else
+typedef Elf32_Ehdr CoreEhdr;
+typedef Elf32_Phdr CorePhdr;
+typedef Elf32_Shdr CoreShdr;
+typedef Elf32_Nhdr CoreNhdr;
+static uint8_t const kCoreClass = ELFCLASS32;
+#endif
+
+// The kernel's struct elf_prstatus, which not every libc provides, up to
+// pr_reg. The general purpose registers follow, then pr_fpvalid.
+struct CorePRStatus {
+  int32_t signo;
+  int32_t code;
+  int32_t errnum;
+  int16_t cursig;
+  unsigned long sigpend;
+  unsigned long sighold;
+  int32_t pid;
+  int32_t ppid;
+  int32_t pgrp;
+  int32_t sid;
+  long times[8]; // utime, stime, cutime and cstime, as struct timeval.
+};
+
+// The kernel's struct elf_prpsinfo.
+struct CorePRPSInfo {
+  char state;
+  char sname;
+  char zomb;
+  char nice;
+  unsigned long flag;
+  __kernel_uid_t uid;
+  __kernel_gid_t gid;
+  int32_t pid;
+  int32_t ppid;
+  int32_t pgrp;
+  int32_t sid;
+  char fname[16];
+  char psargs[80];
+};
+
+struct CoreMapping {
+  uint64_t start;
+  uint64_t end;
+  uint64_t offset;
+  uint32_t flags;
+  std::string path;
+  uint64_t dumpSize;
+  uint64_t fileOffset;
+};
+
+// Register sets that follow NT_PRSTATUS for each thread, when the kernel has
+// them.
+struct CoreRegisterSet {
+  int type;
+  char const *name;
+};
+
+static CoreRegisterSet const kCoreRegisterSets[] = {
+    {NT_PRFPREG, "CORE"},
+#if defined(ARCH_X86) || defined(ARCH_X86_64)
+    {NT_X86_XSTATE, "LINUX"},
+#elif defined(ARCH_ARM)
+    {NT_ARM_VFP, "LINUX"},
+#endif
+};
+
+static size_t const kCopyChunkSize = 1024 * 1024;
+
+static inline uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static void AppendNote(ByteVector &notes, char const *name, uint32_t type,
+                       void const *desc, size_t size) {
+  CoreNhdr nhdr;
+  nhdr.n_namesz = std::strlen(name) + 1;
+  nhdr.n_descsz = size;
+  nhdr.n_type = type;
+
+  auto append = [&notes](void const *data, size_t length) {
+    auto bytes = static_cast<uint8_t const *>(data);
+    notes.insert(notes.end(), bytes, bytes + length);
+    notes.resize(AlignUp(notes.size(), 4), 0);
+  };
+
+  append(&nhdr, sizeof(nhdr));
+  append(name, nhdr.n_namesz);
+  append(desc, size);
+}
+
+static bool ReadMappings(pid_t pid, std::vector<CoreMapping> &mappings) {
+  FILE *fp = ProcFS::OpenFILE(pid, "maps");
+  if (fp == nullptr)
+    return false;
+
+  char buf[PATH_MAX * 2];
+  while (std::fgets(buf, sizeof(buf), fp) != nullptr) {
+    CoreMapping mapping;
+    char r, w, x, p;
+    unsigned int devMajor, devMinor;
+    uint64_t inode;
+    int nread = 0;
+
+    if (std::sscanf(buf,
+                    "%" SCNx64 "-%" SCNx64 " %c%c%c%c %" SCNx64
+                    " %x:%x %" SCNu64 " %n",
+                    &mapping.start, &mapping.end, &r, &w, &x, &p,
+                    &mapping.offset, &devMajor, &devMinor, &inode,
+                    &nread) < 10)
+      continue;
+
+    mapping.flags = (r == 'r' ? PF_R : 0) | (w == 'w' ? PF_W : 0) |
+                    (x == 'x' ? PF_X : 0);
+    mapping.path = buf + nread;
+    if (!mapping.path.empty() && mapping.path.back() == '\n') {
+      mapping.path.pop_back();
+    }
+    mapping.dumpSize = 0;
+    mapping.fileOffset = 0;
+    mappings.push_back(mapping);
+  }
+
+  std::fclose(fp);
+  return true;
+}
+
+//
+// This follows the default coredump_filter of the kernel: anonymous and
+// writable memory is dumped, read-only file mappings are left for the
+// debugger to read from the files themselves, except for the page that holds
+// the ELF header so build ids can still be matched.
+//
+static uint64_t GetDumpSize(CoreMapping const &mapping, size_t pageSize) {
+  if (!(mapping.flags & PF_R))
+    return 0;
+
+  if (mapping.path == "[vvar]" || mapping.path == "[vsyscall]")
+    return 0;
+
+  bool fileBacked = !mapping.path.empty() && mapping.path[0] == '/';
+  if (fileBacked && !(mapping.flags & PF_W)) {
+    if (mapping.offset != 0)
+      return 0;
+    return std::min<uint64_t>(pageSize, mapping.end - mapping.start);
+  }
+
+  return mapping.end - mapping.start;
+}
+
+static ErrorCode WriteAll(int fd, void const *data, size_t size,
+                          uint64_t offset) {
+  auto bytes = static_cast<uint8_t const *>(data);
+  while (size > 0) {
+    ssize_t nwritten = ::pwrite64(fd, bytes, size, offset);
+    if (nwritten < 0) {
+      if (errno == EINTR)
+        continue;
+      return Platform::TranslateError();
+    }
+    bytes += nwritten;
+    size -= nwritten;
+    offset += nwritten;
+  }
+
+  return kSuccess;
+}
+} // namespace
+
+ErrorCode Process::saveCore(std::string &path, bool unique) {
+  ProcessInfo info;
+  CHK(getInfo(info));
+
+  if (info.pointerSize != sizeof(void *)) {
+    DS2LOG(Error, "cannot write cores for %zu-bit processes",
+           info.pointerSize * 8);
+    return kErrorUnsupported;
+  }
+
+  size_t pageSize = Platform::GetPageSize();
+
+  std::vector<CoreMapping> mappings;
+  if (!ReadMappings(_pid, mappings))
+    return kErrorProcessNotFound;
+
+  //
+  // Notes: process-wide ones go after the NT_PRSTATUS of the first thread,
+  // which is the one that stopped, like the kernel does.
+  //
+  CorePRPSInfo psinfo;
+  std::memset(&psinfo, 0, sizeof(psinfo));
+  psinfo.state = 't' - 'a';
+  psinfo.sname = 't';
+  psinfo.uid = info.realUid;
+  psinfo.gid = info.realGid;
+  psinfo.pid = _pid;
+  psinfo.ppid = info.parentPid;
+  psinfo.pgrp = ::getpgid(_pid);
+  psinfo.sid = ::getsid(_pid);
+  std::strncpy(psinfo.fname, ProcFS::GetProcessName(_pid).c_str(),
+               sizeof(psinfo.fname) - 1);
+  std::strncpy(psinfo.psargs,
+               ProcFS::GetProcessArgumentsAsString(_pid, true).c_str(),
+               sizeof(psinfo.psargs) - 1);
+
+  std::string auxv;
+  getAuxiliaryVector(auxv);
+
+  // NT_FILE: count, page size, (start, end, offset in pages) for every file
+  // mapping, and then their paths.
+  std::vector<unsigned long> fileTable(2, 0);
+  std::string filePaths;
+  fileTable[1] = pageSize;
+  for (auto const &mapping : mappings) {
+    if (mapping.path.empty() || mapping.path[0] != '/')
+      continue;
+    fileTable[0]++;
+    fileTable.push_back(mapping.start);
+    fileTable.push_back(mapping.end);
+    fileTable.push_back(mapping.offset / pageSize);
+    filePaths.append(mapping.path.c_str(), mapping.path.size() + 1);
+  }
+  ByteVector fileNote(fileTable.size() * sizeof(unsigned long) +
+                      filePaths.size());
+  std::memcpy(fileNote.data(), fileTable.data(),
+              fileTable.size() * sizeof(unsigned long));
+  std::memcpy(fileNote.data() + fileTable.size() * sizeof(unsigned long),
+              filePaths.data(), filePaths.size());
+
+  std::vector<Thread *> threads;
+  if (_currentThread != nullptr) {
+    threads.push_back(_currentThread);
+  }
+  for (auto const &it : _threads) {
+    if (it.second != _currentThread) {
+      threads.push_back(it.second);
+    }
+  }
+
+  ByteVector notes;
+  bool first = true;
+  for (auto thread : threads) {
+    ProcessThreadId ptid(_pid, thread->tid());
+
+    ByteVector gregs;
+    ErrorCode error = _ptrace.readNoteRegisterSet(ptid, NT_PRSTATUS, gregs);
+    if (error != kSuccess) {
+      DS2LOG(Warning, "cannot read registers of tid %" PRI_PID ": %s",
+             thread->tid(), Stringify::Error(error));
+      continue;
+    }
+
+    std::vector<ByteVector> regSets;
+    for (auto const &regSet : kCoreRegisterSets) {
+      regSets.emplace_back();
+      if (_ptrace.readNoteRegisterSet(ptid, regSet.type, regSets.back()) !=
+          kSuccess) {
+        regSets.back().clear();
+      }
+    }
+
+    CorePRStatus status;
+    std::memset(&status, 0, sizeof(status));
+    if (thread->stopInfo().event == StopInfo::kEventStop) {
+      status.signo = thread->stopInfo().signal;
+      status.cursig = thread->stopInfo().signal;
+    }
+    status.pid = thread->tid();
+    status.ppid = info.parentPid;
+    status.pgrp = psinfo.pgrp;
+    status.sid = psinfo.sid;
+
+    int32_t fpvalid = regSets.empty() ? 0 : !regSets[0].empty();
+    ByteVector prstatus(AlignUp(sizeof(status) + gregs.size() + sizeof(fpvalid),
+                                sizeof(unsigned long)),
+                        0);
+    std::memcpy(prstatus.data(), &status, sizeof(status));
+    std::memcpy(prstatus.data() + sizeof(status), gregs.data(), gregs.size());
+    std::memcpy(prstatus.data() + sizeof(status) + gregs.size(), &fpvalid,
+                sizeof(fpvalid));
+    AppendNote(notes, "CORE", NT_PRSTATUS, prstatus.data(), prstatus.size());
+
+    if (first) {
+      AppendNote(notes, "CORE", NT_PRPSINFO, &psinfo, sizeof(psinfo));
+      if (!auxv.empty()) {
+        AppendNote(notes, "CORE", NT_AUXV, auxv.data(), auxv.size());
+      }
+      AppendNote(notes, "CORE", NT_FILE, fileNote.data(), fileNote.size());
+      first = false;
+    }
+
+    for (size_t n = 0; n < regSets.size(); n++) {
+      if (regSets[n].empty())
+        continue;
+      AppendNote(notes, kCoreRegisterSets[n].name, kCoreRegisterSets[n].type,
+                 regSets[n].data(), regSets[n].size());
+    }
+  }
+
+  //
+  // Layout: ELF header, program headers, notes, then the contents of the
+  // mappings, each starting on a page boundary. With more than PN_XNUM
+  // program headers, the real count goes in the only section header.
+  //
+  size_t phnum = mappings.size() + 1;
+  bool extendedNumbering = (phnum >= PN_XNUM);
+
+  uint64_t phoff = sizeof(CoreEhdr);
+  uint64_t shoff = phoff + phnum * sizeof(CorePhdr);
+  uint64_t notesOffset = shoff + (extendedNumbering ? sizeof(CoreShdr) : 0);
+  uint64_t dataOffset = AlignUp(notesOffset + notes.size(), pageSize);
+
+  for (auto &mapping : mappings) {
+    mapping.dumpSize = GetDumpSize(mapping, pageSize);
+    mapping.fileOffset = dataOffset;
+    dataOffset += mapping.dumpSize;
+  }
+
+  CoreEhdr ehdr;
+  std::memset(&ehdr, 0, sizeof(ehdr));
+  std::memcpy(ehdr.e_ident, ELFMAG, SELFMAG);
+  ehdr.e_ident[EI_CLASS] = kCoreClass;
+  ehdr.e_ident[EI_DATA] =
+      (info.endian == kEndianBig) ? ELFDATA2MSB : ELFDATA2LSB;
+  ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+  ehdr.e_ident[EI_OSABI] = ELFOSABI_NONE;
+  ehdr.e_type = ET_CORE;
+  ehdr.e_machine = ProcFS::GetProcessELFMachineType(_pid);
+  ehdr.e_version = EV_CURRENT;
+  ehdr.e_phoff = phoff;
+  ehdr.e_ehsize = sizeof(CoreEhdr);
+  ehdr.e_phentsize = sizeof(CorePhdr);
+  ehdr.e_phnum = extendedNumbering ? PN_XNUM : phnum;
+  if (extendedNumbering) {
+    ehdr.e_shoff = shoff;
+    ehdr.e_shentsize = sizeof(CoreShdr);
+    ehdr.e_shnum = 1;
+  }
+
+  std::vector<CorePhdr> phdrs(phnum);
+  std::memset(phdrs.data(), 0, phdrs.size() * sizeof(CorePhdr));
+  phdrs[0].p_type = PT_NOTE;
+  phdrs[0].p_offset = notesOffset;
+  phdrs[0].p_filesz = notes.size();
+  phdrs[0].p_align = 4;
+  for (size_t n = 0; n < mappings.size(); n++) {
+    CorePhdr &phdr = phdrs[n + 1];
+    phdr.p_type = PT_LOAD;
+    phdr.p_flags = mappings[n].flags;
+    phdr.p_offset = mappings[n].fileOffset;
+    phdr.p_vaddr = mappings[n].start;
+    phdr.p_filesz = mappings[n].dumpSize;
+    phdr.p_memsz = mappings[n].end - mappings[n].start;
+    phdr.p_align = pageSize;
+  }
+
+  CoreShdr shdr;
+  std::memset(&shdr, 0, sizeof(shdr));
+  shdr.sh_info = phnum;
+
+  int memfd = ProcFS::OpenFd(_pid, "mem", O_RDONLY | O_CLOEXEC);
+  if (memfd < 0)
+    return Platform::TranslateError();
+
+  int fd;
+  if (unique) {
+    // A name nobody else can have picked or planted a link at.
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    fd = ::mkstemp(name.data());
+    if (fd >= 0) {
+      ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+      path = name.data();
+    }
+  } else {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  }
+  if (fd < 0) {
+    ErrorCode error = Platform::TranslateError();
+    ::close(memfd);
+    return error;
+  }
+
+  DS2LOG(Debug, "writing core of pid %" PRI_PID " to %s, %zu mappings", _pid,
+         path.c_str(), mappings.size());
+
+  ErrorCode error = WriteAll(fd, &ehdr, sizeof(ehdr), 0);
+  if (error == kSuccess) {
+    error = WriteAll(fd, phdrs.data(), phdrs.size() * sizeof(CorePhdr), phoff);
+  }
+  if (error == kSuccess && extendedNumbering) {
+    error = WriteAll(fd, &shdr, sizeof(shdr), shoff);
+  }
+  if (error == kSuccess) {
+    error = WriteAll(fd, notes.data(), notes.size(), notesOffset);
+  }
+
+  // Pages we can't read (e.g.: past the end of a truncated file) are left as
+  // holes in the file, which read back as zeroes.
+  ByteVector buffer(kCopyChunkSize);
+  for (auto const &mapping : mappings) {
+    if (error != kSuccess)
+      break;
+
+    uint64_t address = mapping.start;
+    uint64_t end = mapping.start + mapping.dumpSize;
+    while (address < end) {
+      size_t length = std::min<uint64_t>(buffer.size(), end - address);
+      ssize_t nread = ::pread64(memfd, buffer.data(), length, address);
+      if (nread <= 0) {
+        if (nread < 0 && errno == EINTR)
+          continue;
+        address += pageSize;
+        continue;
+      }
+
+      error = WriteAll(fd, buffer.data(), nread,
+                       mapping.fileOffset + (address - mapping.start));
+      if (error != kSuccess)
+        break;
+      address += nread;
+    }
+  }
+
+  if (error == kSuccess && ::ftruncate64(fd, dataOffset) < 0) {
+    error = Platform::TranslateError();
+  }
+
+  ::close(memfd);
+  ::close(fd);
+
+  if (error != kSuccess) {
+    ::unlink(path.c_str());
+  }
+
+  return error;
+}
+} // namespace Linux
+} // namespace Target
+} // namespace ds2
@@ -72,6 +72,14 @@ ErrorCode Thread::updateStopInfo(int waitStatus) {
     //     mark the thread as stopped for a trap;
     // (5) the inferior received a SIGTRAP. This is usually because of a
     //     breakpoint, single step or such;
+    // (6) a thread traced with PTRACE_O_TRACEFORK or PTRACE_O_TRACEVFORK
+    //     called fork(2) or vfork(2). This is reported like (1), and the pid
+    //     of the child is available with PTRACE_GETEVENTMSG. What happens to
+    //     the child is decided by Linux::Process::wait;
+    // (7) a thread traced with PTRACE_O_TRACEEXEC called execve(2). Whatever
+    //     thread called it, the event is reported on the thread group leader;
+    // (8) the child of a thread traced with PTRACE_O_TRACEVFORKDONE exec'd or
+    //     exited, and the thread that called vfork(2) is about to resume.
 
     siginfo_t si;
     ProcessThreadId ptid(process()->pid(), tid());
@@ -84,6 +92,22 @@ ErrorCode Thread::updateStopInfo(int waitStatus) {
 
     if (waitStatus >> 8 == (SIGTRAP | (PTRACE_EVENT_CLONE << 8))) { // (1)
       _stopInfo.event = StopInfo::kEventNone;
+    } else if (waitStatus >> 8 == (SIGTRAP | (PTRACE_EVENT_FORK << 8)) ||
+               waitStatus >> 8 ==
+                   (SIGTRAP | (PTRACE_EVENT_VFORK << 8))) { // (6)
+      unsigned long childPid;
+      CHK(process()->_ptrace.getEventMessage(ptid, childPid));
+      _stopInfo.reason =
+          (waitStatus >> 8 == (SIGTRAP | (PTRACE_EVENT_FORK << 8)))
+              ? StopInfo::kReasonFork
+              : StopInfo::kReasonVFork;
+      _stopInfo.childPid = childPid;
+    } else if (waitStatus >> 8 ==
+               (SIGTRAP | (PTRACE_EVENT_VFORK_DONE << 8))) { // (8)
+      _stopInfo.reason = StopInfo::kReasonVForkDone;
+    } else if (waitStatus >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) { // (7)
+      _stopInfo.reason = StopInfo::kReasonExec;
+      _stopInfo.execPath = ProcFS::GetProcessExecutablePath(process()->pid());
     } else if (si.si_code == SI_TKILL && si.si_pid == getpid()) { // (2)
       // The only signal we are supposed to send to the inferior is a SIGSTOP.
       DS2ASSERT(_stopInfo.signal == SIGSTOP);
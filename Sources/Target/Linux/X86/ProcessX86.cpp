@@ -58,6 +58,11 @@ ErrorCode Process::deallocateMemory(uint64_t address, size_t size) {
 
   return kSuccess;
 }
+
+ErrorCode Process::prepareForkCode(ByteVector &codestr) {
+  X86Sys::PrepareForkCode(codestr);
+  return kSuccess;
+}
 } // namespace Linux
 } // namespace Target
 } // namespace ds2
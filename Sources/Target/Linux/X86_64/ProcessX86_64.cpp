@@ -82,6 +82,16 @@ ErrorCode Process::deallocateMemory(uint64_t address, size_t size) {
 
   return kSuccess;
 }
+
+ErrorCode Process::prepareForkCode(ByteVector &codestr) {
+  if (is32BitProcess(this)) {
+    X86Sys::PrepareForkCode(codestr);
+  } else {
+    X86_64Sys::PrepareForkCode(codestr);
+  }
+
+  return kSuccess;
+}
 } // namespace Linux
 } // namespace Target
 } // namespace ds2
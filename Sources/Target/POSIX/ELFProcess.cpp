@@ -9,8 +9,10 @@
 //
 
 #include "DebugServer2/Target/POSIX/ELFProcess.h"
+#include "DebugServer2/Host/Platform.h"
 #include "DebugServer2/Support/POSIX/ELFSupport.h"
 
+#include <algorithm>
 #include <dirent.h>
 #include <elf.h>
 #include <limits>
@@ -22,7 +24,9 @@ typedef Elf32_Auxinfo Elf32_auxv_t;
 typedef Elf64_Auxinfo Elf64_auxv_t;
 #endif
 
+using ds2::Host::Platform;
 using ds2::Support::ELFSupport;
+using ds2::Support::ELFSymbolTable;
 
 #define super ds2::Target::POSIX::Process
 
@@ -230,6 +234,8 @@ EnumerateLinkMap(ELFProcess *process, Address addressToDPtr,
 }
 } // namespace
 
+ELFProcess::ELFProcess() : super(), _loadedModulesValid(false) {}
+
 ErrorCode ELFProcess::getAuxiliaryVector(std::string &auxv) {
   ErrorCode error = updateAuxiliaryVector();
   if (error == kSuccess || error == kErrorAlreadyExist) {
@@ -509,6 +515,84 @@ ErrorCode ELFProcess::enumerateSharedLibraries(
     return EnumerateLinkMap<uint32_t>(this, address, cb);
   }
 }
+
+ErrorCode ELFProcess::updateLoadedModules() {
+  if (_loadedModulesValid)
+    return kSuccess;
+
+  _loadedModules.clear();
+
+  CHK(enumerateSharedLibraries([&](SharedLibraryInfo const &library) {
+    LoadedModule module;
+
+    module.path = library.path;
+    if (module.path.empty() && library.main) {
+      ProcessInfo info;
+      if (Platform::GetProcessInfo(_pid, info) && !info.name.empty() &&
+          info.name[0] == '/') {
+        module.path = info.name;
+      }
+    }
+
+    // Things like the vDSO have no file on the host.
+    if (module.path.empty() ||
+        ELFSymbolTable::Get(module.path, module.symbols) != kSuccess ||
+        module.symbols->lowAddress() >= module.symbols->highAddress())
+      return;
+
+    module.bias = library.svr4.baseAddress;
+    module.start = module.bias + module.symbols->lowAddress();
+    module.end = module.bias + module.symbols->highAddress();
+    _loadedModules.push_back(module);
+  }));
+
+  std::sort(_loadedModules.begin(), _loadedModules.end(),
+            [](LoadedModule const &lhs, LoadedModule const &rhs) {
+              return lhs.start < rhs.start;
+            });
+
+  _loadedModulesValid = true;
+  return kSuccess;
+}
+
+ErrorCode ELFProcess::symbolicate(std::vector<uint64_t> const &addresses,
+                                  SymbolInfo::Collection &symbols) {
+  CHK(updateLoadedModules());
+
+  symbols.clear();
+  symbols.reserve(addresses.size());
+
+  for (uint64_t address : addresses) {
+    SymbolInfo symbol;
+    symbol.clear();
+    symbol.offset = address;
+
+    auto it = std::upper_bound(
+        _loadedModules.begin(), _loadedModules.end(), address,
+        [](uint64_t address, LoadedModule const &module) {
+          return address < module.start;
+        });
+    if (it != _loadedModules.begin() && address < (--it)->end) {
+      char const *name;
+      symbol.module = it->path;
+      if (it->symbols->lookup(address - it->bias, name, symbol.offset)) {
+        symbol.name = name;
+      } else {
+        symbol.offset = address - it->bias;
+      }
+    }
+
+    symbols.push_back(symbol);
+  }
+
+  return kSuccess;
+}
+
+ErrorCode ELFProcess::beforeResume() {
+  // Libraries can be loaded and unloaded while the process runs.
+  _loadedModulesValid = false;
+  return super::beforeResume();
+}
 } // namespace POSIX
 } // namespace Target
 } // namespace ds2
@@ -27,21 +27,41 @@ Thread::Thread(ds2::Target::Process *process, ThreadId tid)
 
 ErrorCode Thread::readCPUState(Architecture::CPUState &state) {
   // TODO cache CPU state
-  ProcessInfo info;
+  ProcessInfo const *info;
 
   CHK(_process->getInfo(info));
   CHK(process()->ptrace().readCPUState(ProcessThreadId(process()->pid(), tid()),
-                                       info, state));
+                                       *info, state));
 
   return kSuccess;
 }
 
 ErrorCode Thread::writeCPUState(Architecture::CPUState const &state) {
-  ProcessInfo info;
+  ProcessInfo const *info;
 
   CHK(_process->getInfo(info));
   CHK(process()->ptrace().writeCPUState(
-      ProcessThreadId(process()->pid(), tid()), info, state));
+      ProcessThreadId(process()->pid(), tid()), *info, state));
+
+  return kSuccess;
+}
+
+ErrorCode Thread::readGPRState(Architecture::CPUState &state) {
+  ProcessInfo const *info;
+
+  CHK(_process->getInfo(info));
+  CHK(process()->ptrace().readGPRState(ProcessThreadId(process()->pid(), tid()),
+                                       *info, state));
+
+  return kSuccess;
+}
+
+ErrorCode Thread::writeGPRState(Architecture::CPUState const &state) {
+  ProcessInfo const *info;
+
+  CHK(_process->getInfo(info));
+  CHK(process()->ptrace().writeGPRState(
+      ProcessThreadId(process()->pid(), tid()), *info, state));
 
   return kSuccess;
 }
@@ -103,9 +123,9 @@ ErrorCode Thread::step(int signal, Address const &address) {
 
   DS2LOG(Debug, "stepping tid %d", tid());
 
-  ProcessInfo info;
+  ProcessInfo const *info;
   CHK(process()->getInfo(info));
-  CHK(process()->ptrace().step(ProcessThreadId(process()->pid(), tid()), info,
+  CHK(process()->ptrace().step(ProcessThreadId(process()->pid(), tid()), *info,
                                signal, address));
   _state = kStepped;
   return kSuccess;
@@ -114,11 +134,11 @@ ErrorCode Thread::step(int signal, Address const &address) {
 
 ErrorCode Thread::resume(int signal, Address const &address) {
   if (_state == kStopped || _state == kStepped) {
-    ProcessInfo info;
+    ProcessInfo const *info;
 
     CHK(process()->getInfo(info));
     CHK(process()->ptrace().resume(ProcessThreadId(process()->pid(), tid()),
-                                   info, signal, address));
+                                   *info, signal, address));
     _state = kRunning;
     _stopInfo.signal = 0;
   } else if (_state == kTerminated) {
@@ -0,0 +1,137 @@
+//
+// Copyright (c) 2014-present, Facebook, Inc.
+// All rights reserved.
+//
+// This source code is licensed under the University of Illinois/NCSA Open
+// Source License found in the LICENSE file in the root directory of this
+// source tree. An additional grant of patent rights can be found in the
+// PATENTS file in the same directory.
+//
+
+#include "DebugServer2/Utils/MD5.h"
+
+#include <cstring>
+
+namespace ds2 {
+namespace Utils {
+
+static uint32_t const kSines[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+    0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+    0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+    0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+    0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+    0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+static uint8_t const kShifts[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+
+static inline uint32_t RotateLeft(uint32_t x, unsigned n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+MD5::MD5() : _length(0) {
+  _state[0] = 0x67452301;
+  _state[1] = 0xefcdab89;
+  _state[2] = 0x98badcfe;
+  _state[3] = 0x10325476;
+}
+
+void MD5::transform(uint8_t const block[64]) {
+  uint32_t m[16];
+  for (size_t n = 0; n < 16; n++) {
+    m[n] = static_cast<uint32_t>(block[n * 4]) |
+           static_cast<uint32_t>(block[n * 4 + 1]) << 8 |
+           static_cast<uint32_t>(block[n * 4 + 2]) << 16 |
+           static_cast<uint32_t>(block[n * 4 + 3]) << 24;
+  }
+
+  uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+
+  for (unsigned n = 0; n < 64; n++) {
+    uint32_t f;
+    unsigned g;
+
+    if (n < 16) {
+      f = (b & c) | (~b & d);
+      g = n;
+    } else if (n < 32) {
+      f = (d & b) | (~d & c);
+      g = (5 * n + 1) % 16;
+    } else if (n < 48) {
+      f = b ^ c ^ d;
+      g = (3 * n + 5) % 16;
+    } else {
+      f = c ^ (b | ~d);
+      g = (7 * n) % 16;
+    }
+
+    uint32_t tmp = d;
+    d = c;
+    c = b;
+    b += RotateLeft(a + f + kSines[n] + m[g], kShifts[n]);
+    a = tmp;
+  }
+
+  _state[0] += a;
+  _state[1] += b;
+  _state[2] += c;
+  _state[3] += d;
+}
+
+void MD5::update(void const *data, size_t length) {
+  if (length == 0)
+    return;
+
+  auto bytes = static_cast<uint8_t const *>(data);
+  size_t used = _length % sizeof(_buffer);
+
+  _length += length;
+
+  if (used != 0) {
+    size_t count = sizeof(_buffer) - used;
+    if (count > length) {
+      count = length;
+    }
+    std::memcpy(_buffer + used, bytes, count);
+    bytes += count, length -= count;
+    if (used + count < sizeof(_buffer))
+      return;
+    transform(_buffer);
+  }
+
+  for (; length >= sizeof(_buffer);
+       bytes += sizeof(_buffer), length -= sizeof(_buffer)) {
+    transform(bytes);
+  }
+
+  std::memcpy(_buffer, bytes, length);
+}
+
+void MD5::finalize(uint8_t digest[kDigestSize]) {
+  uint64_t bits = _length * 8;
+  static uint8_t const padding[64] = {0x80};
+
+  size_t used = _length % sizeof(_buffer);
+  update(padding, (used < 56) ? (56 - used) : (120 - used));
+
+  uint8_t encodedLength[8];
+  for (size_t n = 0; n < 8; n++) {
+    encodedLength[n] = static_cast<uint8_t>(bits >> (n * 8));
+  }
+  update(encodedLength, sizeof(encodedLength));
+
+  for (size_t n = 0; n < kDigestSize; n++) {
+    digest[n] = static_cast<uint8_t>(_state[n / 4] >> ((n % 4) * 8));
+  }
+}
+} // namespace Utils
+} // namespace ds2
@@ -10,10 +10,18 @@
 
 #include "DebugServer2/Core/BreakpointManager.h"
 #include "DebugServer2/Core/SessionThread.h"
+#include "DebugServer2/GDBRemote/DebugServerPool.h"
 #include "DebugServer2/GDBRemote/DebugSessionImpl.h"
+#if defined(OS_LINUX)
+#include "DebugServer2/GDBRemote/PlatformServer.h"
+#endif
 #include "DebugServer2/GDBRemote/PlatformSessionImpl.h"
 #include "DebugServer2/GDBRemote/ProtocolHelpers.h"
 #include "DebugServer2/GDBRemote/SlaveSessionImpl.h"
+#if defined(OS_LINUX)
+#include "DebugServer2/Host/Linux/SharedMemoryChannel.h"
+#include "DebugServer2/Host/Linux/TracerPool.h"
+#endif
 #include "DebugServer2/Host/Platform.h"
 #include "DebugServer2/Host/QueueChannel.h"
 #include "DebugServer2/Host/Socket.h"
@@ -21,6 +29,7 @@
 #include "DebugServer2/Utils/Log.h"
 #include "DebugServer2/Utils/OptParse.h"
 #include "DebugServer2/Utils/String.h"
+#include "DebugServer2/Utils/Stringify.h"
 
 #include <cstdio>
 #include <cstdlib>
@@ -35,14 +44,22 @@
 #endif
 
 using ds2::BreakpointManager;
+using ds2::GDBRemote::DebugServerPool;
 using ds2::GDBRemote::DebugSessionImpl;
+#if defined(OS_LINUX)
+using ds2::GDBRemote::PlatformServer;
+#endif
 using ds2::GDBRemote::PlatformSessionImpl;
 using ds2::GDBRemote::Session;
 using ds2::GDBRemote::SessionDelegate;
 using ds2::GDBRemote::SlaveSessionImpl;
+#if defined(OS_LINUX)
+using ds2::Host::Linux::SharedMemoryChannel;
+#endif
 using ds2::Host::Platform;
 using ds2::Host::QueueChannel;
 using ds2::Host::Socket;
+using ds2::Utils::Stringify;
 
 static std::string gDefaultPort = "12345";
 static std::string gDefaultHost = "127.0.0.1";
@@ -195,7 +212,15 @@ static std::unique_ptr<Socket> CreateSocket(std::string const &arg,
 static int RunDebugServer(Socket *socket, SessionDelegate *impl) {
   Session session(gGDBCompat ? ds2::GDBRemote::kCompatibilityModeGDB
                              : ds2::GDBRemote::kCompatibilityModeLLDB);
+#if defined(OS_LINUX)
+  // Local debuggers can ask to exchange packets over shared memory.
+  std::unique_ptr<SharedMemoryChannel> shm =
+      SharedMemoryChannel::Accept(socket);
+  QueueChannel qchannel(shm ? static_cast<ds2::Host::Channel *>(shm.get())
+                            : socket);
+#else
   QueueChannel qchannel(socket);
+#endif
   SessionThread thread(&qchannel, &session);
 
   session.setDelegate(impl);
@@ -267,6 +292,15 @@ static int GdbserverMain(int argc, char **argv) {
                  "remove an element from the environment before lauch");
   opts.addOption(ds2::OptParse::stringOption, "attach", 'a',
                  "attach to the name or PID specified");
+  opts.addOption(ds2::OptParse::boolOption, "persistent", 'p',
+                 "keep the inferior and wait for another debugger when the "
+                 "connection is lost");
+#if defined(OS_LINUX)
+  opts.addOption(ds2::OptParse::boolOption, "keep-forks", 'K',
+                 "keep tracing forked children instead of detaching them");
+  opts.addOption(ds2::OptParse::stringOption, "tracer-threads", 'T',
+                 "number of tracer threads for attached processes");
+#endif
 
   // lldb-server compatibility options.
   opts.addOption(ds2::OptParse::boolOption, "gdb-compat", 'g',
@@ -393,6 +427,14 @@ static int GdbserverMain(int argc, char **argv) {
     ds2::Utils::Daemonize();
   }
 
+#if defined(OS_LINUX)
+  // This has to happen after daemonizing, threads don't survive fork(2).
+  if (!opts.getString("tracer-threads").empty()) {
+    ds2::Host::Linux::TracerPool::Initialize(
+        atoi(opts.getString("tracer-threads").c_str()));
+  }
+#endif
+
   std::unique_ptr<DebugSessionImpl> impl;
 
   if (attachPid > 0)
@@ -402,6 +444,29 @@ static int GdbserverMain(int argc, char **argv) {
   else
     impl = ds2::make_unique<DebugSessionImpl>();
 
+#if defined(OS_LINUX)
+  impl->setDetachOnFork(!opts.getBool("keep-forks"));
+#endif
+
+  if (opts.getBool("persistent")) {
+#if defined(OS_POSIX)
+    bool listening = (fd < 0 && !reverse);
+#else
+    bool listening = !reverse;
+#endif
+    if (!listening) {
+      DS2LOG(Fatal, "persistent mode requires listening for connections");
+    }
+
+    // The next debugger connects to the same socket.
+    impl->setPersistent(true);
+    do {
+      RunDebugServer(socket->accept().get(), impl.get());
+    } while (impl->prepareReconnect());
+
+    return EXIT_SUCCESS;
+  }
+
 #if defined(OS_POSIX)
   return RunDebugServer(
       (fd >= 0 || reverse) ? socket.get() : socket->accept().get(), impl.get());
@@ -422,6 +487,16 @@ static int PlatformMain(int argc, char **argv) {
                  "specify the [host]:port to listen on");
   opts.addOption(ds2::OptParse::boolOption, "server", 's',
                  "create a new process for each client (default)", true);
+  opts.addOption(ds2::OptParse::stringOption, "server-pool", 'P',
+                 "keep this many debug servers launched in advance");
+#if defined(OS_LINUX)
+  opts.addOption(ds2::OptParse::stringOption, "workers", 'w',
+                 "number of threads serving platform clients (default 4)");
+  opts.addOption(ds2::OptParse::stringOption, "max-clients", 'm',
+                 "maximum number of connected clients");
+  opts.addOption(ds2::OptParse::stringOption, "idle-timeout", 'i',
+                 "disconnect clients idle for this many seconds");
+#endif
 
   opts.parse(argc, argv);
   HandleSharedOptions(opts);
@@ -430,30 +505,58 @@ static int PlatformMain(int argc, char **argv) {
     opts.usageDie("--listen required in platform mode");
   }
 
+  std::unique_ptr<Socket> serverSocket =
+      CreateSocket(opts.getString("listen"), false);
+
+  if (gDaemonize) {
+    ds2::Utils::Daemonize();
+  }
+
+  // The pool has to be started after daemonizing, as its refill thread would
+  // not survive the fork.
+  std::unique_ptr<DebugServerPool> pool;
+  int poolSize = opts.getString("server-pool").empty()
+                     ? 0
+                     : atoi(opts.getString("server-pool").c_str());
+  if (poolSize > 0) {
+    pool = ds2::make_unique<DebugServerPool>(poolSize);
+    pool->start();
+  }
+
+#if defined(OS_LINUX)
+  int numWorkers = opts.getString("workers").empty()
+                       ? 4
+                       : atoi(opts.getString("workers").c_str());
+  int maxClients = opts.getString("max-clients").empty()
+                       ? 0
+                       : atoi(opts.getString("max-clients").c_str());
+  int idleTimeout = opts.getString("idle-timeout").empty()
+                        ? 0
+                        : atoi(opts.getString("idle-timeout").c_str());
+
+  PlatformServer server(std::move(serverSocket), pool.get(),
+                        std::max(maxClients, 0), std::max(idleTimeout, 0));
+  ds2::ErrorCode error = server.run(std::max(numWorkers, 1));
+  DS2LOG(Error, "platform server failed: %s", Stringify::Error(error));
+  return EXIT_FAILURE;
+#else
   struct PlatformClient {
     std::unique_ptr<Socket> socket;
     PlatformSessionImpl impl;
     Session session;
 
-    PlatformClient(std::unique_ptr<Socket> socket_)
-        : socket(std::move(socket_)),
+    PlatformClient(std::unique_ptr<Socket> socket_, DebugServerPool *pool)
+        : socket(std::move(socket_)), impl(pool),
           session(ds2::GDBRemote::kCompatibilityModeLLDB) {
       session.setDelegate(&impl);
       session.create(socket.get());
     }
   };
 
-  std::unique_ptr<Socket> serverSocket =
-      CreateSocket(opts.getString("listen"), false);
-
-  if (gDaemonize) {
-    ds2::Utils::Daemonize();
-  }
-
   do {
     std::unique_ptr<Socket> clientSocket = serverSocket->accept();
     auto platformClient =
-        ds2::make_unique<PlatformClient>(std::move(clientSocket));
+        ds2::make_unique<PlatformClient>(std::move(clientSocket), pool.get());
 
     std::thread thread(
         [](std::unique_ptr<PlatformClient> client) {
@@ -465,6 +568,7 @@ static int PlatformMain(int argc, char **argv) {
 
     thread.detach();
   } while (true);
+#endif
 }
 
 static int SlaveMain(int argc, char **argv) {